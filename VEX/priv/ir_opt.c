@@ -3963,7 +3963,7 @@ static AvailExpr* irExpr_to_AvailExpr ( IRExpr* e, Bool allowLoadsToBeCSEd )
    is something of a dodgy proposition if the guest program is doing
    some screwy stuff to do with races and spinloops. */
 
-static Bool do_cse_BB ( IRSB* bb, Bool allowLoadsToBeCSEd )
+Bool do_cse_BB ( IRSB* bb, Bool allowLoadsToBeCSEd )
 {
    Int        i, j, paranoia;
    IRTemp     t, q;
@@ -6667,7 +6667,8 @@ IRSB* do_iropt_BB(
          Bool (*preciseMemExnsFn)(Int,Int,VexRegisterUpdates),
          VexRegisterUpdates pxControl,
          Addr    guest_addr,
-         VexArch guest_arch
+         VexArch guest_arch,
+         /*OUT*/Bool* loop_unrolled
       )
 {
    static Int n_total     = 0;
@@ -6676,6 +6677,7 @@ IRSB* do_iropt_BB(
    Bool hasGetIorPutI, hasVorFtemps;
 
    n_total++;
+   *loop_unrolled = False;
 
    /* Flatness: this function assumes that the incoming block is already flat.
       That's because all blocks that arrive here should already have been
@@ -6771,6 +6773,7 @@ IRSB* do_iropt_BB(
             do_cse_BB( bb, False/*!allowLoadsToBeCSEd*/ );
             do_deadcode_BB( bb );
          }
+         *loop_unrolled = True;
          if (0) vex_printf("vex iropt: unrolled a loop\n");
       }
 
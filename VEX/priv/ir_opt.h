@@ -40,7 +40,8 @@
 
 /* Top level optimiser entry point.  Returns a new BB.  Operates
    under the control of the global "vex_control" struct and of the
-   supplied |pxControl| argument. */
+   supplied |pxControl| argument.  |*loop_unrolled| is set to
+   indicate whether bb was a self-looping block which got unrolled. */
 extern 
 IRSB* do_iropt_BB (
          IRSB* bb,
@@ -48,7 +49,8 @@ IRSB* do_iropt_BB (
          Bool (*preciseMemExnsFn)(Int,Int,VexRegisterUpdates),
          VexRegisterUpdates pxControl,
          Addr    guest_addr,
-         VexArch guest_arch
+         VexArch guest_arch,
+         /*OUT*/Bool* loop_unrolled
       );
 
 /* Do a constant folding/propagation pass. */
@@ -59,6 +61,11 @@ IRSB* cprop_BB ( IRSB* );
 extern
 void do_deadcode_BB ( IRSB* bb );
 
+/* Do a common-subexpression elimination pass on flat IR.  bb is
+   destructively modified.  Returns True if any change was made. */
+extern
+Bool do_cse_BB ( IRSB* bb, Bool allowLoadsToBeCSEd );
+
 /* The tree-builder.  Make (approximately) maximal safe trees.  bb is
    destructively modified.  Returns (unrelatedly, but useful later on)
    the guest address of the highest addressed byte from any insn in
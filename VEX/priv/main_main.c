@@ -190,6 +190,7 @@ void LibVEX_default_VexControl ( /*OUT*/ VexControl* vcon )
    vcon->iropt_level                    = 2;
    vcon->iropt_register_updates_default = VexRegUpdUnwindregsAtMemAccess;
    vcon->iropt_unroll_thresh            = 120;
+   vcon->iropt_cse_unrolled             = False;
    vcon->guest_max_insns                = 60;
    vcon->guest_chase                    = True;
    vcon->regalloc_version               = 3;
@@ -226,6 +227,8 @@ void LibVEX_Init (
    vassert(vcon->iropt_level <= 2);
    vassert(vcon->iropt_unroll_thresh >= 0);
    vassert(vcon->iropt_unroll_thresh <= 400);
+   vassert(vcon->iropt_cse_unrolled == False
+           || vcon->iropt_cse_unrolled == True);
    vassert(vcon->guest_max_insns >= 1);
    vassert(vcon->guest_max_insns <= 100);
    vassert(vcon->guest_chase == False || vcon->guest_chase == True);
@@ -325,6 +328,7 @@ IRSB* LibVEX_FrontEnd ( /*MOD*/ VexTranslateArgs* vta,
    IRSB*           irsb;
    Int             i;
    Int             offB_CMSTART, offB_CMLEN, offB_GUEST_IP, szB_GUEST_IP;
+   Bool            loop_unrolled;
    IRType          guest_word_type;
    IRType          host_word_type;
 
@@ -338,6 +342,7 @@ IRSB* LibVEX_FrontEnd ( /*MOD*/ VexTranslateArgs* vta,
    offB_CMLEN              = 0;
    offB_GUEST_IP           = 0;
    szB_GUEST_IP            = 0;
+   loop_unrolled           = False;
 
    vassert(vex_initdone);
    vassert(vta->needs_self_check  != NULL);
@@ -651,7 +656,8 @@ IRSB* LibVEX_FrontEnd ( /*MOD*/ VexTranslateArgs* vta,
    /* Clean it up, hopefully a lot. */
    irsb = do_iropt_BB ( irsb, specHelper, preciseMemExnsFn, *pxControl,
                               vta->guest_bytes_addr,
-                              vta->arch_guest );
+                              vta->arch_guest,
+                              &loop_unrolled );
 
    // JRS 2016 Aug 03: Sanity checking is expensive, we already checked
    // the output of the front end, and iropt never screws up the IR by
@@ -701,10 +707,20 @@ IRSB* LibVEX_FrontEnd ( /*MOD*/ VexTranslateArgs* vta,
    //    sanityCheckIRSB( irsb, "after instrumentation",
    //                     True/*must be flat*/, guest_word_type );
 
-   /* Do a post-instrumentation cleanup pass. */
+   /* Do a post-instrumentation cleanup pass.  If the block is an
+      unrolled loop, the instrumentation of each copy of the loop body
+      recomputes whatever the tool derives from values which are
+      invariant in the loop (eg, memcheck's shadow values for
+      loop-invariant addresses).  CSE then leaves only the first
+      copy's computation in place, in effect hoisting it out of the
+      remaining iterations.  This costs a CSE pass over a block which
+      is up to 8 times the size of the original, so it is only done
+      when asked for. */
    if (vta->instrument1 || vta->instrument2) {
       do_deadcode_BB( irsb );
       irsb = cprop_BB( irsb );
+      if (loop_unrolled && vex_control.iropt_cse_unrolled)
+         do_cse_BB( irsb, False/*!allowLoadsToBeCSEd*/ );
       do_deadcode_BB( irsb );
       sanityCheckIRSB( irsb, "after post-instrumentation cleanup",
                        True/*must be flat*/, guest_word_type );
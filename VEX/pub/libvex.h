@@ -511,6 +511,11 @@ typedef
          numbers make it more enthusiastic about loop unrolling.
          Default=120.  A setting of zero disables unrolling.  */
       Int iropt_unroll_thresh;
+      /* Should the post-instrumentation cleanup of an unrolled loop
+         also do CSE, so that instrumentation which each copy of the
+         loop body computes from loop-invariant values is only done
+         once?  Default=False. */
+      Bool iropt_cse_unrolled;
       /* What's the maximum basic block length the front end(s) allow?
          BBs longer than this are split up.  Default=60 (guest
          insns). */
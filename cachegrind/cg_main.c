@@ -29,6 +29,7 @@
 
 #include "pub_tool_basics.h"
 #include "pub_tool_debuginfo.h"
+#include "pub_tool_hashtable.h"
 #include "pub_tool_libcbase.h"
 #include "pub_tool_libcassert.h"
 #include "pub_tool_libcfile.h"
@@ -60,6 +61,9 @@
 static Bool  clo_cache_sim  = True;  /* do cache simulation? */
 static Bool  clo_branch_sim = False; /* do branch simulation? */
 static const HChar* clo_cachegrind_out_file = "cachegrind.out.%p";
+static CachePolicy clo_ML_policy = NonInclusive;
+static CachePolicy clo_LL_policy = NonInclusive;
+static Int   clo_cores      = 1;     /* number of simulated cores */
 
 /*------------------------------------------------------------*/
 /*--- Cachesim configuration                               ---*/
@@ -75,10 +79,19 @@ typedef
    struct {
       ULong a;  /* total # memory accesses of this kind */
       ULong m1; /* misses in the first level cache */
-      ULong mL; /* misses in the second level cache */
+      ULong mM; /* misses in the mid-level cache, if any */
+      ULong mL; /* misses in the last-level cache */
    }
    CacheCC;
 
+typedef
+   struct {
+      ULong mr;  /* D1 read misses that were coherence misses */
+      ULong mw;  /* D1 write misses that were coherence misses */
+      ULong inv; /* writes that invalidated the block in other cores */
+   }
+   CoherenceCC;
+
 typedef
    struct {
       ULong b;  /* total # branches of this kind */
@@ -105,6 +118,7 @@ typedef struct {
    CacheCC  Ir;  /* Insn read counts */
    CacheCC  Dr;  /* Data read counts */
    CacheCC  Dw;  /* Data write/modify counts */
+   CoherenceCC Dc; /* Data coherence counts, with more than one core */
    BranchCC Bc;  /* Conditional branch counts */
    BranchCC Bi;  /* Indirect branch counts */
 } LineCC;
@@ -267,13 +281,19 @@ static LineCC* get_lineCC(Addr origAddr)
       lineCC->loc.line = loc.line;
       lineCC->Ir.a     = 0;
       lineCC->Ir.m1    = 0;
+      lineCC->Ir.mM    = 0;
       lineCC->Ir.mL    = 0;
       lineCC->Dr.a     = 0;
       lineCC->Dr.m1    = 0;
+      lineCC->Dr.mM    = 0;
       lineCC->Dr.mL    = 0;
       lineCC->Dw.a     = 0;
       lineCC->Dw.m1    = 0;
+      lineCC->Dw.mM    = 0;
       lineCC->Dw.mL    = 0;
+      lineCC->Dc.mr    = 0;
+      lineCC->Dc.mw    = 0;
+      lineCC->Dc.inv   = 0;
       lineCC->Bc.b     = 0;
       lineCC->Bc.mp    = 0;
       lineCC->Bi.b     = 0;
@@ -332,7 +352,8 @@ void log_1IrGen_0D_cache_access(InstrInfo* n)
    //VG_(printf)("1IrGen_0D :  CCaddr=0x%010lx,  iaddr=0x%010lx,  isize=%lu\n",
    //             n, n->instr_addr, n->instr_len);
    cachesim_I1_doref_Gen(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.mM,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
 }
 
@@ -342,7 +363,8 @@ void log_1IrNoX_0D_cache_access(InstrInfo* n)
    //VG_(printf)("1IrNoX_0D :  CCaddr=0x%010lx,  iaddr=0x%010lx,  isize=%lu\n",
    //             n, n->instr_addr, n->instr_len);
    cachesim_I1_doref_NoX(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.mM,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
 }
 
@@ -354,10 +376,12 @@ void log_2IrNoX_0D_cache_access(InstrInfo* n, InstrInfo* n2)
    //            n,  n->instr_addr,  n->instr_len,
    //            n2, n2->instr_addr, n2->instr_len);
    cachesim_I1_doref_NoX(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.mM,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
    cachesim_I1_doref_NoX(n2->instr_addr, n2->instr_len,
-			 &n2->parent->Ir.m1, &n2->parent->Ir.mL);
+			 &n2->parent->Ir.m1, &n2->parent->Ir.mM,
+			 &n2->parent->Ir.mL);
    n2->parent->Ir.a++;
 }
 
@@ -371,13 +395,16 @@ void log_3IrNoX_0D_cache_access(InstrInfo* n, InstrInfo* n2, InstrInfo* n3)
    //            n2, n2->instr_addr, n2->instr_len,
    //            n3, n3->instr_addr, n3->instr_len);
    cachesim_I1_doref_NoX(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.mM,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
    cachesim_I1_doref_NoX(n2->instr_addr, n2->instr_len,
-			 &n2->parent->Ir.m1, &n2->parent->Ir.mL);
+			 &n2->parent->Ir.m1, &n2->parent->Ir.mM,
+			 &n2->parent->Ir.mL);
    n2->parent->Ir.a++;
    cachesim_I1_doref_NoX(n3->instr_addr, n3->instr_len,
-			 &n3->parent->Ir.m1, &n3->parent->Ir.mL);
+			 &n3->parent->Ir.m1, &n3->parent->Ir.mM,
+			 &n3->parent->Ir.mL);
    n3->parent->Ir.a++;
 }
 
@@ -388,11 +415,13 @@ void log_1IrNoX_1Dr_cache_access(InstrInfo* n, Addr data_addr, Word data_size)
    //            "                               daddr=0x%010lx,  dsize=%lu\n",
    //            n, n->instr_addr, n->instr_len, data_addr, data_size);
    cachesim_I1_doref_NoX(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.mM,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
 
-   cachesim_D1_doref(data_addr, data_size, 
-                     &n->parent->Dr.m1, &n->parent->Dr.mL);
+   cachesim_D1_doref(data_addr, data_size, False,
+                     &n->parent->Dr.m1, &n->parent->Dr.mM,
+                     &n->parent->Dr.mL, &n->parent->Dc.mr, NULL);
    n->parent->Dr.a++;
 }
 
@@ -403,14 +432,34 @@ void log_1IrNoX_1Dw_cache_access(InstrInfo* n, Addr data_addr, Word data_size)
    //            "                               daddr=0x%010lx,  dsize=%lu\n",
    //            n, n->instr_addr, n->instr_len, data_addr, data_size);
    cachesim_I1_doref_NoX(n->instr_addr, n->instr_len,
-			 &n->parent->Ir.m1, &n->parent->Ir.mL);
+			 &n->parent->Ir.m1, &n->parent->Ir.mM,
+			 &n->parent->Ir.mL);
    n->parent->Ir.a++;
 
-   cachesim_D1_doref(data_addr, data_size, 
-                     &n->parent->Dw.m1, &n->parent->Dw.mL);
+   cachesim_D1_doref(data_addr, data_size, True,
+                     &n->parent->Dw.m1, &n->parent->Dw.mM,
+                     &n->parent->Dw.mL, &n->parent->Dc.mw,
+                     &n->parent->Dc.inv);
    n->parent->Dw.a++;
 }
 
+// Modifies are counted as reads, but need the block for themselves in a
+// multi-core simulation.
+static VG_REGPARM(3)
+void log_1IrNoX_1Dm_cache_access(InstrInfo* n, Addr data_addr, Word data_size)
+{
+   cachesim_I1_doref_NoX(n->instr_addr, n->instr_len,
+			 &n->parent->Ir.m1, &n->parent->Ir.mM,
+			 &n->parent->Ir.mL);
+   n->parent->Ir.a++;
+
+   cachesim_D1_doref(data_addr, data_size, True,
+                     &n->parent->Dr.m1, &n->parent->Dr.mM,
+                     &n->parent->Dr.mL, &n->parent->Dc.mr,
+                     &n->parent->Dc.inv);
+   n->parent->Dr.a++;
+}
+
 /* Note that addEvent_D_guarded assumes that log_0Ir_1Dr_cache_access
    and log_0Ir_1Dw_cache_access have exactly the same prototype.  If
    you change them, you must change addEvent_D_guarded too. */
@@ -419,8 +468,9 @@ void log_0Ir_1Dr_cache_access(InstrInfo* n, Addr data_addr, Word data_size)
 {
    //VG_(printf)("0Ir_1Dr:  CCaddr=0x%010lx,  daddr=0x%010lx,  dsize=%lu\n",
    //            n, data_addr, data_size);
-   cachesim_D1_doref(data_addr, data_size, 
-                     &n->parent->Dr.m1, &n->parent->Dr.mL);
+   cachesim_D1_doref(data_addr, data_size, False,
+                     &n->parent->Dr.m1, &n->parent->Dr.mM,
+                     &n->parent->Dr.mL, &n->parent->Dc.mr, NULL);
    n->parent->Dr.a++;
 }
 
@@ -430,11 +480,24 @@ void log_0Ir_1Dw_cache_access(InstrInfo* n, Addr data_addr, Word data_size)
 {
    //VG_(printf)("0Ir_1Dw:  CCaddr=0x%010lx,  daddr=0x%010lx,  dsize=%lu\n",
    //            n, data_addr, data_size);
-   cachesim_D1_doref(data_addr, data_size, 
-                     &n->parent->Dw.m1, &n->parent->Dw.mL);
+   cachesim_D1_doref(data_addr, data_size, True,
+                     &n->parent->Dw.m1, &n->parent->Dw.mM,
+                     &n->parent->Dw.mL, &n->parent->Dc.mw,
+                     &n->parent->Dc.inv);
    n->parent->Dw.a++;
 }
 
+/* See comment on log_1IrNoX_1Dm_cache_access. */
+static VG_REGPARM(3)
+void log_0Ir_1Dm_cache_access(InstrInfo* n, Addr data_addr, Word data_size)
+{
+   cachesim_D1_doref(data_addr, data_size, True,
+                     &n->parent->Dr.m1, &n->parent->Dr.mM,
+                     &n->parent->Dr.mL, &n->parent->Dc.mr,
+                     &n->parent->Dc.inv);
+   n->parent->Dr.a++;
+}
+
 /* For branches, we consult two different predictors, one which
    predicts taken/untaken for conditional branches, and the other
    which predicts the branch target address for indirect branches
@@ -740,8 +803,13 @@ static void flushEvents ( CgState* cgs )
                   immediately preceding Ir.  Same applies to analogous
                   assertions in the subsequent cases. */
                tl_assert(ev2->inode == ev->inode);
-               helperName = "log_1IrNoX_1Dr_cache_access";
-               helperAddr = &log_1IrNoX_1Dr_cache_access;
+               if (ev2->tag == Ev_Dr) {
+                  helperName = "log_1IrNoX_1Dr_cache_access";
+                  helperAddr = &log_1IrNoX_1Dr_cache_access;
+               } else {
+                  helperName = "log_1IrNoX_1Dm_cache_access";
+                  helperAddr = &log_1IrNoX_1Dm_cache_access;
+               }
                argv = mkIRExprVec_3( i_node_expr,
                                      get_Event_dea(ev2),
                                      mkIRExpr_HWord( get_Event_dszB(ev2) ) );
@@ -819,8 +887,7 @@ static void flushEvents ( CgState* cgs )
 	    i++;
             break;
          case Ev_Dr:
-         case Ev_Dm:
-            /* Data read or modify */
+            /* Data read */
             helperName = "log_0Ir_1Dr_cache_access";
             helperAddr = &log_0Ir_1Dr_cache_access;
             argv = mkIRExprVec_3( i_node_expr, 
@@ -829,6 +896,16 @@ static void flushEvents ( CgState* cgs )
             regparms = 3;
             i++;
             break;
+         case Ev_Dm:
+            /* Data modify */
+            helperName = "log_0Ir_1Dm_cache_access";
+            helperAddr = &log_0Ir_1Dm_cache_access;
+            argv = mkIRExprVec_3( i_node_expr, 
+                                  get_Event_dea(ev), 
+                                  mkIRExpr_HWord( get_Event_dszB(ev) ) );
+            regparms = 3;
+            i++;
+            break;
          case Ev_Dw:
             /* Data write */
             helperName = "log_0Ir_1Dw_cache_access";
@@ -1357,6 +1434,7 @@ IRSB* cg_instrument ( VgCallbackClosure* closure,
 static cache_t clo_I1_cache = UNDEFINED_CACHE;
 static cache_t clo_D1_cache = UNDEFINED_CACHE;
 static cache_t clo_LL_cache = UNDEFINED_CACHE;
+static cache_t clo_ML_cache = UNDEFINED_CACHE;
 
 /*------------------------------------------------------------*/
 /*--- cg_fini() and related function                       ---*/
@@ -1369,6 +1447,42 @@ static CacheCC  Dr_total;
 static CacheCC  Dw_total;
 static BranchCC Bc_total;
 static BranchCC Bi_total;
+static CoherenceCC Dc_total;
+
+// Prints the counts of one line (or the totals) in the order given by the
+// "events:" line, followed by a newline.
+static void fprint_counts(VgFile* fp, const CacheCC* Ir, const CacheCC* Dr,
+                          const CacheCC* Dw, const CoherenceCC* Dc,
+                          const BranchCC* Bc, const BranchCC* Bi)
+{
+   if (clo_cache_sim && ML_present) {
+      VG_(fprintf)(fp, " %llu %llu %llu %llu"
+                       " %llu %llu %llu %llu"
+                       " %llu %llu %llu %llu",
+                       Ir->a, Ir->m1, Ir->mM, Ir->mL,
+                       Dr->a, Dr->m1, Dr->mM, Dr->mL,
+                       Dw->a, Dw->m1, Dw->mM, Dw->mL);
+   }
+   else if (clo_cache_sim) {
+      VG_(fprintf)(fp, " %llu %llu %llu"
+                       " %llu %llu %llu"
+                       " %llu %llu %llu",
+                       Ir->a, Ir->m1, Ir->mL,
+                       Dr->a, Dr->m1, Dr->mL,
+                       Dw->a, Dw->m1, Dw->mL);
+   }
+   else {
+      VG_(fprintf)(fp, " %llu", Ir->a);
+   }
+   if (clo_cache_sim && n_cores > 1) {
+      VG_(fprintf)(fp, " %llu %llu %llu", Dc->mr, Dc->mw, Dc->inv);
+   }
+   if (clo_branch_sim) {
+      VG_(fprintf)(fp, " %llu %llu %llu %llu",
+                       Bc->b, Bc->mp, Bi->b, Bi->mp);
+   }
+   VG_(fprintf)(fp, "\n");
+}
 
 static void fprint_CC_table_and_calc_totals(void)
 {
@@ -1400,12 +1514,14 @@ static void fprint_CC_table_and_calc_totals(void)
       VG_(free)(cachegrind_out_file);
    }
 
-   // "desc:" lines (giving I1/D1/LL cache configuration).  The spaces after
-   // the 2nd colon makes cg_annotate's output look nicer.
+   // "desc:" lines (giving I1/D1/ML/LL cache configuration).  The spaces
+   // after the 2nd colon makes cg_annotate's output look nicer.
    VG_(fprintf)(fp,  "desc: I1 cache:         %s\n"
-                     "desc: D1 cache:         %s\n"
-                     "desc: LL cache:         %s\n",
-                     I1.desc_line, D1.desc_line, LL.desc_line);
+                     "desc: D1 cache:         %s\n",
+                     I1.desc_line, D1.desc_line);
+   if (ML_present)
+      VG_(fprintf)(fp, "desc: ML cache:         %s\n", ML.desc_line);
+   VG_(fprintf)(fp,  "desc: LL cache:         %s\n", LL.desc_line);
 
    // "cmd:" line
    VG_(fprintf)(fp, "cmd: %s", VG_(args_the_exename));
@@ -1414,20 +1530,20 @@ static void fprint_CC_table_and_calc_totals(void)
       VG_(fprintf)(fp, " %s", arg);
    }
    // "events:" line
-   if (clo_cache_sim && clo_branch_sim) {
-      VG_(fprintf)(fp, "\nevents: Ir I1mr ILmr Dr D1mr DLmr Dw D1mw DLmw "
-                                  "Bc Bcm Bi Bim\n");
+   VG_(fprintf)(fp, "\nevents: Ir");
+   if (clo_cache_sim && ML_present) {
+      VG_(fprintf)(fp, " I1mr IMmr ILmr Dr D1mr DMmr DLmr Dw D1mw DMmw DLmw");
    }
-   else if (clo_cache_sim && !clo_branch_sim) {
-      VG_(fprintf)(fp, "\nevents: Ir I1mr ILmr Dr D1mr DLmr Dw D1mw DLmw "
-                                  "\n");
+   else if (clo_cache_sim) {
+      VG_(fprintf)(fp, " I1mr ILmr Dr D1mr DLmr Dw D1mw DLmw");
    }
-   else if (!clo_cache_sim && clo_branch_sim) {
-      VG_(fprintf)(fp, "\nevents: Ir Bc Bcm Bi Bim\n");
+   if (clo_cache_sim && n_cores > 1) {
+      VG_(fprintf)(fp, " Dcmr Dcmw Dinv");
    }
-   else {
-      VG_(fprintf)(fp, "\nevents: Ir\n");
+   if (clo_branch_sim) {
+      VG_(fprintf)(fp, " Bc Bcm Bi Bim");
    }
+   VG_(fprintf)(fp, "\n");
 
    // Traverse every lineCC
    VG_(OSetGen_ResetIter)(CC_table);
@@ -1455,51 +1571,26 @@ static void fprint_CC_table_and_calc_totals(void)
       }
 
       // Print the LineCC
-      if (clo_cache_sim && clo_branch_sim) {
-         VG_(fprintf)(fp,  "%d %llu %llu %llu"
-                             " %llu %llu %llu"
-                             " %llu %llu %llu"
-                             " %llu %llu %llu %llu\n",
-                            lineCC->loc.line,
-                            lineCC->Ir.a, lineCC->Ir.m1, lineCC->Ir.mL, 
-                            lineCC->Dr.a, lineCC->Dr.m1, lineCC->Dr.mL,
-                            lineCC->Dw.a, lineCC->Dw.m1, lineCC->Dw.mL,
-                            lineCC->Bc.b, lineCC->Bc.mp, 
-                            lineCC->Bi.b, lineCC->Bi.mp);
-      }
-      else if (clo_cache_sim && !clo_branch_sim) {
-         VG_(fprintf)(fp,  "%d %llu %llu %llu"
-                             " %llu %llu %llu"
-                             " %llu %llu %llu\n",
-                            lineCC->loc.line,
-                            lineCC->Ir.a, lineCC->Ir.m1, lineCC->Ir.mL, 
-                            lineCC->Dr.a, lineCC->Dr.m1, lineCC->Dr.mL,
-                            lineCC->Dw.a, lineCC->Dw.m1, lineCC->Dw.mL);
-      }
-      else if (!clo_cache_sim && clo_branch_sim) {
-         VG_(fprintf)(fp,  "%d %llu"
-                             " %llu %llu %llu %llu\n",
-                            lineCC->loc.line,
-                            lineCC->Ir.a, 
-                            lineCC->Bc.b, lineCC->Bc.mp, 
-                            lineCC->Bi.b, lineCC->Bi.mp);
-      }
-      else {
-         VG_(fprintf)(fp,  "%d %llu\n",
-                            lineCC->loc.line,
-                            lineCC->Ir.a);
-      }
+      VG_(fprintf)(fp, "%d", lineCC->loc.line);
+      fprint_counts(fp, &lineCC->Ir, &lineCC->Dr, &lineCC->Dw,
+                        &lineCC->Dc, &lineCC->Bc, &lineCC->Bi);
 
       // Update summary stats
       Ir_total.a  += lineCC->Ir.a;
       Ir_total.m1 += lineCC->Ir.m1;
+      Ir_total.mM += lineCC->Ir.mM;
       Ir_total.mL += lineCC->Ir.mL;
       Dr_total.a  += lineCC->Dr.a;
       Dr_total.m1 += lineCC->Dr.m1;
+      Dr_total.mM += lineCC->Dr.mM;
       Dr_total.mL += lineCC->Dr.mL;
       Dw_total.a  += lineCC->Dw.a;
       Dw_total.m1 += lineCC->Dw.m1;
+      Dw_total.mM += lineCC->Dw.mM;
       Dw_total.mL += lineCC->Dw.mL;
+      Dc_total.mr += lineCC->Dc.mr;
+      Dc_total.mw += lineCC->Dc.mw;
+      Dc_total.inv += lineCC->Dc.inv;
       Bc_total.b  += lineCC->Bc.b;
       Bc_total.mp += lineCC->Bc.mp;
       Bi_total.b  += lineCC->Bi.b;
@@ -1510,40 +1601,9 @@ static void fprint_CC_table_and_calc_totals(void)
 
    // Summary stats must come after rest of table, since we calculate them
    // during traversal.  */
-   if (clo_cache_sim && clo_branch_sim) {
-      VG_(fprintf)(fp,  "summary:"
-                        " %llu %llu %llu"
-                        " %llu %llu %llu"
-                        " %llu %llu %llu"
-                        " %llu %llu %llu %llu\n", 
-                        Ir_total.a, Ir_total.m1, Ir_total.mL,
-                        Dr_total.a, Dr_total.m1, Dr_total.mL,
-                        Dw_total.a, Dw_total.m1, Dw_total.mL,
-                        Bc_total.b, Bc_total.mp, 
-                        Bi_total.b, Bi_total.mp);
-   }
-   else if (clo_cache_sim && !clo_branch_sim) {
-      VG_(fprintf)(fp,  "summary:"
-                        " %llu %llu %llu"
-                        " %llu %llu %llu"
-                        " %llu %llu %llu\n",
-                        Ir_total.a, Ir_total.m1, Ir_total.mL,
-                        Dr_total.a, Dr_total.m1, Dr_total.mL,
-                        Dw_total.a, Dw_total.m1, Dw_total.mL);
-   }
-   else if (!clo_cache_sim && clo_branch_sim) {
-      VG_(fprintf)(fp,  "summary:"
-                        " %llu"
-                        " %llu %llu %llu %llu\n", 
-                        Ir_total.a,
-                        Bc_total.b, Bc_total.mp, 
-                        Bi_total.b, Bi_total.mp);
-   }
-   else {
-      VG_(fprintf)(fp, "summary:"
-                        " %llu\n", 
-                        Ir_total.a);
-   }
+   VG_(fprintf)(fp, "summary:");
+   fprint_counts(fp, &Ir_total, &Dr_total, &Dw_total, &Dc_total,
+                     &Bc_total, &Bi_total);
 
    VG_(fclose)(fp);
 }
@@ -1565,6 +1625,8 @@ static void cg_fini(Int exitcode)
 
    CacheCC  D_total;
    BranchCC B_total;
+   ULong ML_total_m, ML_total_mr, ML_total_mw,
+         ML_total, ML_total_r, ML_total_w;
    ULong LL_total_m, LL_total_mr, LL_total_mw,
          LL_total, LL_total_r, LL_total_w;
    Int l1, l2, l3;
@@ -1593,11 +1655,16 @@ static void cg_fini(Int exitcode)
       miss numbers */
    if (clo_cache_sim) {
       VG_(umsg)(fmt, "I1  misses:   ", Ir_total.m1);
+      if (ML_present)
+         VG_(umsg)(fmt, "MLi misses:   ", Ir_total.mM);
       VG_(umsg)(fmt, "LLi misses:   ", Ir_total.mL);
 
       if (0 == Ir_total.a) Ir_total.a = 1;
       VG_(umsg)("I1  miss rate: %*.2f%%\n", l1,
                 Ir_total.m1 * 100.0 / Ir_total.a);
+      if (ML_present)
+         VG_(umsg)("MLi miss rate: %*.2f%%\n", l1,
+                   Ir_total.mM * 100.0 / Ir_total.a);
       VG_(umsg)("LLi miss rate: %*.2f%%\n", l1,
                 Ir_total.mL * 100.0 / Ir_total.a);
       VG_(umsg)("\n");
@@ -1606,6 +1673,7 @@ static void cg_fini(Int exitcode)
        * determine the width of columns 2 & 3. */
       D_total.a  = Dr_total.a  + Dw_total.a;
       D_total.m1 = Dr_total.m1 + Dw_total.m1;
+      D_total.mM = Dr_total.mM + Dw_total.mM;
       D_total.mL = Dr_total.mL + Dw_total.mL;
 
       /* Make format string, getting width right for numbers */
@@ -1616,6 +1684,9 @@ static void cg_fini(Int exitcode)
                      D_total.a, Dr_total.a, Dw_total.a);
       VG_(umsg)(fmt, "D1  misses:   ",
                      D_total.m1, Dr_total.m1, Dw_total.m1);
+      if (ML_present)
+         VG_(umsg)(fmt, "MLd misses:   ",
+                        D_total.mM, Dr_total.mM, Dw_total.mM);
       VG_(umsg)(fmt, "LLd misses:   ",
                      D_total.mL, Dr_total.mL, Dw_total.mL);
 
@@ -1626,17 +1697,50 @@ static void cg_fini(Int exitcode)
                 l1, D_total.m1  * 100.0 / D_total.a,
                 l2, Dr_total.m1 * 100.0 / Dr_total.a,
                 l3, Dw_total.m1 * 100.0 / Dw_total.a);
+      if (ML_present)
+         VG_(umsg)("MLd miss rate: %*.1f%% (%*.1f%%     + %*.1f%%  )\n",
+                   l1, D_total.mM  * 100.0 / D_total.a,
+                   l2, Dr_total.mM * 100.0 / Dr_total.a,
+                   l3, Dw_total.mM * 100.0 / Dw_total.a);
       VG_(umsg)("LLd miss rate: %*.1f%% (%*.1f%%     + %*.1f%%  )\n",
                 l1, D_total.mL  * 100.0 / D_total.a,
                 l2, Dr_total.mL * 100.0 / Dr_total.a,
                 l3, Dw_total.mL * 100.0 / Dw_total.a);
       VG_(umsg)("\n");
 
+      /* ML overall results */
+
+      if (ML_present) {
+         ML_total   = Dr_total.m1 + Dw_total.m1 + Ir_total.m1;
+         ML_total_r = Dr_total.m1 + Ir_total.m1;
+         ML_total_w = Dw_total.m1;
+         VG_(umsg)(fmt, "ML refs:      ",
+                        ML_total, ML_total_r, ML_total_w);
+
+         ML_total_m  = Dr_total.mM + Dw_total.mM + Ir_total.mM;
+         ML_total_mr = Dr_total.mM + Ir_total.mM;
+         ML_total_mw = Dw_total.mM;
+         VG_(umsg)(fmt, "ML misses:    ",
+                        ML_total_m, ML_total_mr, ML_total_mw);
+
+         VG_(umsg)("ML miss rate:  %*.1f%% (%*.1f%%     + %*.1f%%  )\n",
+                   l1, ML_total_m  * 100.0 / (Ir_total.a + D_total.a),
+                   l2, ML_total_mr * 100.0 / (Ir_total.a + Dr_total.a),
+                   l3, ML_total_mw * 100.0 / Dw_total.a);
+         VG_(umsg)("\n");
+      }
+
       /* LL overall results */
 
-      LL_total   = Dr_total.m1 + Dw_total.m1 + Ir_total.m1;
-      LL_total_r = Dr_total.m1 + Ir_total.m1;
-      LL_total_w = Dw_total.m1;
+      if (ML_present) {
+         LL_total   = Dr_total.mM + Dw_total.mM + Ir_total.mM;
+         LL_total_r = Dr_total.mM + Ir_total.mM;
+         LL_total_w = Dw_total.mM;
+      } else {
+         LL_total   = Dr_total.m1 + Dw_total.m1 + Ir_total.m1;
+         LL_total_r = Dr_total.m1 + Ir_total.m1;
+         LL_total_w = Dw_total.m1;
+      }
       VG_(umsg)(fmt, "LL refs:      ",
                      LL_total, LL_total_r, LL_total_w);
 
@@ -1650,6 +1754,16 @@ static void cg_fini(Int exitcode)
                 l1, LL_total_m  * 100.0 / (Ir_total.a + D_total.a),
                 l2, LL_total_mr * 100.0 / (Ir_total.a + Dr_total.a),
                 l3, LL_total_mw * 100.0 / Dw_total.a);
+
+      /* Coherence results, when simulating more than one core */
+
+      if (n_cores > 1) {
+         VG_(umsg)("\n");
+         VG_(umsg)(fmt, "Coh misses:   ",
+                        Dc_total.mr + Dc_total.mw, Dc_total.mr, Dc_total.mw);
+         VG_(sprintf)(fmt, "%%s %%,%dllu\n", l1);
+         VG_(umsg)(fmt, "Invalidations:", Dc_total.inv);
+      }
    }
 
    /* If branch profiling is enabled, show branch overall results. */
@@ -1704,6 +1818,9 @@ static void cg_fini(Int exitcode)
                 VG_(OSetGen_Size)(CC_table));
       VG_(dmsg)("cachegrind: InstrInfo table size: %u\n",
                 VG_(OSetGen_Size)(instrInfoTable));
+      if (dir_chunks != NULL)
+         VG_(dmsg)("cachegrind: coherence directory chunks: %u\n",
+                   VG_(HT_count_nodes)(dir_chunks));
    }
 }
 
@@ -1744,10 +1861,24 @@ static Bool cg_process_cmd_line_option(const HChar* arg)
                               &clo_I1_cache,
                               &clo_D1_cache,
                               &clo_LL_cache)) {}
+   else if (VG_(str_clo_ML_cache_opt)(arg, &clo_ML_cache)) {}
 
    else if VG_STR_CLO( arg, "--cachegrind-out-file", clo_cachegrind_out_file) {}
    else if VG_BOOL_CLO(arg, "--cache-sim",  clo_cache_sim)  {}
    else if VG_BOOL_CLO(arg, "--branch-sim", clo_branch_sim) {}
+   else if VG_XACT_CLO(arg, "--ML-policy=non-inclusive",
+                            clo_ML_policy, NonInclusive) {}
+   else if VG_XACT_CLO(arg, "--ML-policy=inclusive",
+                            clo_ML_policy, Inclusive) {}
+   else if VG_XACT_CLO(arg, "--ML-policy=exclusive",
+                            clo_ML_policy, Exclusive) {}
+   else if VG_XACT_CLO(arg, "--LL-policy=non-inclusive",
+                            clo_LL_policy, NonInclusive) {}
+   else if VG_XACT_CLO(arg, "--LL-policy=inclusive",
+                            clo_LL_policy, Inclusive) {}
+   else if VG_XACT_CLO(arg, "--LL-policy=exclusive",
+                            clo_LL_policy, Exclusive) {}
+   else if VG_BINT_CLO(arg, "--cores", clo_cores, 1, MAX_CORES) {}
    else
       return False;
 
@@ -1758,6 +1889,15 @@ static void cg_print_usage(void)
 {
    VG_(print_cache_clo_opts)();
    VG_(printf)(
+"    --ML=<size>,<assoc>,<line_size>  also simulate a mid-level cache\n"
+"                                     between L1 and LL [no]\n"
+"    --ML-policy=non-inclusive|inclusive|exclusive\n"
+"                                     how ML relates to L1 [non-inclusive]\n"
+"    --LL-policy=non-inclusive|inclusive|exclusive\n"
+"                                     how LL relates to the caches above it\n"
+"                                     [non-inclusive]\n"
+"    --cores=<number>                 simulate private I1, D1 and ML caches\n"
+"                                     for each of <number> cores [1]\n"
 "    --cache-sim=yes|no               collect cache stats? [yes]\n"
 "    --branch-sim=yes|no              collect branch prediction stats? [no]\n"
 "    --cachegrind-out-file=<file>     output file name [cachegrind.out.%%p]\n"
@@ -1801,9 +1941,21 @@ static void cg_pre_clo_init(void)
                                    cg_print_debug_usage);
 }
 
+// Threads run on the simulated cores in turn, by thread id: as Valgrind
+// runs one thread at a time, a core switch happens when the scheduler
+// switches threads.
+static void cg_start_client_code(ThreadId tid, ULong blocks_done)
+{
+   Int core = (tid - 1) % n_cores;
+
+   if (core != curr_core)
+      cachesim_switch_core(core);
+}
+
 static void cg_post_clo_init(void)
 {
    cache_t I1c, D1c, LLc; 
+   Bool    ML_defined = clo_ML_cache.size != -1;
 
    CC_table =
       VG_(OSetGen_Create)(offsetof(LineCC, loc),
@@ -1831,6 +1983,8 @@ static void cg_post_clo_init(void)
    // cache lines at any cache level
    min_line_size = (I1c.line_size < D1c.line_size) ? I1c.line_size : D1c.line_size;
    min_line_size = (LLc.line_size < min_line_size) ? LLc.line_size : min_line_size;
+   if (ML_defined && clo_ML_cache.line_size < min_line_size)
+      min_line_size = clo_ML_cache.line_size;
 
    Int largest_load_or_store_size
       = VG_(machine_get_size_of_largest_guest_register)();
@@ -1846,7 +2000,40 @@ static void cg_post_clo_init(void)
       VG_(exit)(1);
    }
 
-   cachesim_initcaches(I1c, D1c, LLc);
+   if (!ML_defined && clo_ML_policy != NonInclusive) {
+      VG_(umsg)("Cachegrind: cannot continue: --ML-policy requires --ML.\n");
+      VG_(exit)(1);
+   }
+
+   // Inclusive and exclusive caches exchange tags with the levels above
+   // them, and coherence invalidates the same tag at every level, so all
+   // the lines must be of the same size.
+   if ((clo_ML_policy != NonInclusive || clo_LL_policy != NonInclusive)
+       && (I1c.line_size != LLc.line_size || D1c.line_size != LLc.line_size
+           || (ML_defined && clo_ML_cache.line_size != LLc.line_size))) {
+      VG_(umsg)("Cachegrind: cannot continue: inclusive and exclusive caches\n");
+      VG_(umsg)("  require all the simulated caches to have the same line size.\n");
+      VG_(exit)(1);
+   }
+   if (clo_cores > 1
+       && (I1c.line_size != LLc.line_size || D1c.line_size != LLc.line_size
+           || (ML_defined && clo_ML_cache.line_size != LLc.line_size))) {
+      VG_(umsg)("Cachegrind: cannot continue: --cores requires all the\n");
+      VG_(umsg)("  simulated caches to have the same line size.\n");
+      VG_(exit)(1);
+   }
+
+   if (ML_defined && VG_(clo_verbosity) >= 2) {
+      VG_(umsg)("  ML: %'d B, %d-way, %d B lines\n",
+                clo_ML_cache.size, clo_ML_cache.assoc,
+                clo_ML_cache.line_size);
+   }
+
+   cachesim_initcaches(I1c, D1c, ML_defined ? &clo_ML_cache : NULL, LLc,
+                       clo_ML_policy, clo_LL_policy, clo_cores);
+
+   if (clo_cores > 1)
+      VG_(track_start_client_code)(cg_start_client_code);
 }
 
 VG_DETERMINE_INTERFACE_VERSION(cg_pre_clo_init)
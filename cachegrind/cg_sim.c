@@ -34,8 +34,27 @@
       - both blocks hit                  --> one hit
       - one block hits, the other misses --> one miss
       - both blocks miss                 --> one miss (not two)
+  - only the blocks that miss in L1 are looked up in the levels below
+  - the levels below L1 are looked up with the block holding the first
+    byte referenced in the L1 block, so a level with smaller lines than
+    L1 sees at most one of the lines an L1 block covers
 */
 
+/* How a cache below L1 relates to the caches above it:
+   - NonInclusive: filled on a miss, evicts without telling anyone;
+   - Inclusive:    filled on a miss, and a line it evicts is also
+                   invalidated in the caches above it;
+   - Exclusive:    filled only with the lines evicted from the cache
+                   directly above it; a line that hits moves up and
+                   leaves this cache.
+   Inclusive and Exclusive require all levels to have the same line
+   size, as they pass tags between levels. */
+typedef enum { NonInclusive, Inclusive, Exclusive } CachePolicy;
+
+/* Tag of an empty line.  Tags are block numbers (see
+   cachesim_ref_missed), and no block number has all bits set. */
+#define INVALID_TAG  (~(UWord)0)
+
 typedef struct {
    Int          size;                   /* bytes */
    Int          assoc;
@@ -74,59 +93,266 @@ static void cachesim_initcache(cache_t config, cache_t2* c)
                          sizeof(UWord) * c->sets * c->assoc);
 
    for (i = 0; i < c->sets * c->assoc; i++)
-      c->tags[i] = 0;
+      c->tags[i] = INVALID_TAG;
 }
 
 /* This attribute forces GCC to inline the function, getting rid of a
  * lot of indirection around the cache_t2 pointer, if it is known to be
  * constant in the caller (the caller is inlined itself).
  * Without inlining of simulator functions, cachegrind can get 40% slower.
+ *
+ * The tags of a set are kept in MRU to LRU order.  On a miss, the LRU
+ * tag is evicted and stored in *victim (INVALID_TAG if the line was
+ * empty).
  */
 __attribute__((always_inline))
 static __inline__
-Bool cachesim_setref_is_miss(cache_t2* c, UInt set_no, UWord tag)
+Bool cachesim_setref_is_miss(cache_t2* c, UInt set_no, UWord tag,
+                             UWord* victim)
 {
-   int i, j;
-   UWord *set;
+   int i;
+   UWord *set, prev, curr;
 
    set = &(c->tags[set_no * c->assoc]);
 
-   /* This loop is unrolled for just the first case, which is the most */
-   /* common.  We can't unroll any further because it would screw up   */
-   /* if we have a direct-mapped (1-way) cache.                        */
+   /* The MRU tag is checked first, as it is the most common case.   */
    if (tag == set[0])
       return False;
 
-   /* If the tag is one other than the MRU, move it into the MRU spot  */
-   /* and shuffle the rest down.                                       */
+   /* Otherwise put the tag in the MRU spot and shuffle the others    */
+   /* down while looking for it, so that a set is only walked once.   */
+   /* The shuffle stops where the tag was found; on a miss it pushes  */
+   /* the LRU tag out of the set.                                     */
+   prev   = set[0];
+   set[0] = tag;
    for (i = 1; i < c->assoc; i++) {
+      curr   = set[i];
+      set[i] = prev;
+      if (tag == curr)
+         return False;
+      prev = curr;
+   }
+   *victim = prev;
+
+   return True;
+}
+
+/* Removes tag from the lines tags of a cache of c's geometry, if it is
+   there, making its line the LRU one.  Returns True if it was there. */
+static Bool cachesim_remove_from(const cache_t2* c, UWord* tags, UWord tag)
+{
+   Int    i;
+   UWord* set = &(tags[(tag & c->sets_min_1) * c->assoc]);
+
+   for (i = 0; i < c->assoc; i++) {
       if (tag == set[i]) {
-         for (j = i; j > 0; j--) {
-            set[j] = set[j - 1];
-         }
-         set[0] = tag;
+         for (; i < c->assoc - 1; i++)
+            set[i] = set[i + 1];
+         set[c->assoc - 1] = INVALID_TAG;
+         return True;
+      }
+   }
+   return False;
+}
 
-         return False;
+static Bool cachesim_remove(cache_t2* c, UWord tag)
+{
+   return cachesim_remove_from(c, c->tags, tag);
+}
+
+/* Puts tag into c as its MRU line, for a line evicted from the cache
+   above an exclusive cache.  Returns the tag it evicts in turn. */
+static UWord cachesim_insert(cache_t2* c, UWord tag)
+{
+   UWord victim = INVALID_TAG;
+
+   cachesim_setref_is_miss(c, tag & c->sets_min_1, tag, &victim);
+   return victim;
+}
+
+
+static cache_t2 LL;
+static cache_t2 ML;
+static cache_t2 I1;
+static cache_t2 D1;
+
+static Bool        ML_present = False;
+static CachePolicy ML_policy  = NonInclusive;
+static CachePolicy LL_policy  = NonInclusive;
+
+/* Multi-core simulation.  Each simulated core has its own I1, D1 and ML
+   caches; LL is shared.  I1, D1 and ML above always are the caches of
+   the current core: they only differ between cores by their tags, so
+   switching cores just switches the tags.  With a single core, this is
+   all there is to it. */
+#define MAX_CORES  32   /* the bits of a UInt */
+
+/* Number of entries of a core's owned filter; a power of two. */
+#define N_OWNED    1024
+
+typedef struct {
+   UWord* I1_tags;
+   UWord* D1_tags;
+   UWord* ML_tags;
+   /* Filter of blocks that only this core holds, whether it modified
+      them (MESI's M state) or not yet (E).  Block b is owned if
+      owned[b % N_OWNED] == b.  Only used with more than one core. */
+   UWord* owned;
+} core_t;
+
+static Int     n_cores   = 1;
+static Int     curr_core = 0;
+static core_t* cores;
+
+static void cachesim_initcaches(cache_t I1c, cache_t D1c,
+                                const cache_t* MLc, cache_t LLc,
+                                CachePolicy MLp, CachePolicy LLp,
+                                Int ncores)
+{
+   Int i, j;
+
+   cachesim_initcache(I1c, &I1);
+   cachesim_initcache(D1c, &D1);
+   if (MLc) {
+      cachesim_initcache(*MLc, &ML);
+      ML_present = True;
+      ML_policy  = MLp;
+   }
+   cachesim_initcache(LLc, &LL);
+   LL_policy = LLp;
+
+   tl_assert(ncores >= 1 && ncores <= MAX_CORES);
+   n_cores = ncores;
+   cores   = VG_(malloc)("cg.sim.ci.2", n_cores * sizeof(core_t));
+   cores[0].I1_tags = I1.tags;
+   cores[0].D1_tags = D1.tags;
+   cores[0].ML_tags = ML_present ? ML.tags : NULL;
+   for (i = 1; i < n_cores; i++) {
+      cachesim_initcache(I1c, &I1);
+      cachesim_initcache(D1c, &D1);
+      cores[i].I1_tags = I1.tags;
+      cores[i].D1_tags = D1.tags;
+      cores[i].ML_tags = NULL;
+      if (ML_present) {
+         cachesim_initcache(*MLc, &ML);
+         cores[i].ML_tags = ML.tags;
+      }
+   }
+   for (i = 0; i < n_cores; i++) {
+      cores[i].owned = NULL;
+      if (n_cores > 1) {
+         cores[i].owned = VG_(malloc)("cg.sim.ci.3", N_OWNED * sizeof(UWord));
+         for (j = 0; j < N_OWNED; j++)
+            cores[i].owned[j] = INVALID_TAG;
       }
    }
+   I1.tags = cores[0].I1_tags;
+   D1.tags = cores[0].D1_tags;
+   if (ML_present)
+      ML.tags = cores[0].ML_tags;
+}
+
+/* Makes core the current core. */
+static void cachesim_switch_core(Int core)
+{
+   curr_core = core;
+   I1.tags   = cores[core].I1_tags;
+   D1.tags   = cores[core].D1_tags;
+   if (ML_present)
+      ML.tags = cores[core].ML_tags;
+}
+
+/* Removes tag from the I1, D1 and ML caches of every core. */
+static void cachesim_remove_from_cores(UWord tag)
+{
+   Int i;
 
-   /* A miss;  install this tag as MRU, shuffle rest down. */
-   for (j = c->assoc - 1; j > 0; j--) {
-      set[j] = set[j - 1];
+   for (i = 0; i < n_cores; i++) {
+      cachesim_remove_from(&I1, cores[i].I1_tags, tag);
+      cachesim_remove_from(&D1, cores[i].D1_tags, tag);
+      if (ML_present)
+         cachesim_remove_from(&ML, cores[i].ML_tags, tag);
    }
-   set[0] = tag;
+}
 
-   return True;
+/* Which levels a reference missed in, as returned by
+   cachesim_lower_ref and accumulated by the doref functions. */
+#define MISSED_L1  1
+#define MISSED_ML  2
+#define MISSED_LL  4
+
+/* Simulates the levels below L1 for the block holding address a, which
+   has just missed in L1 and evicted victim from it.  Returns the
+   MISSED_* flags of the levels below L1 that missed. */
+static UInt cachesim_lower_ref(Addr a, UWord victim)
+{
+   UInt  missed = 0;
+   Bool  found  = False;
+   UWord tag, evicted;
+
+   if (ML_present) {
+      tag     = a >> ML.line_size_bits;
+      evicted = INVALID_TAG;
+      if (ML_policy == Exclusive) {
+         found = cachesim_remove(&ML, tag);
+         if (victim != INVALID_TAG)
+            evicted = cachesim_insert(&ML, victim);
+      } else {
+         found = !cachesim_setref_is_miss(&ML, tag & ML.sets_min_1, tag,
+                                          &evicted);
+         if (ML_policy == Inclusive && evicted != INVALID_TAG) {
+            cachesim_remove(&I1, evicted);
+            cachesim_remove(&D1, evicted);
+         }
+      }
+      if (!found)
+         missed |= MISSED_ML;
+      victim = evicted;
+   }
+
+   if (found && (LL_policy != Exclusive || victim == INVALID_TAG))
+      return missed;
+
+   tag     = a >> LL.line_size_bits;
+   evicted = INVALID_TAG;
+   if (LL_policy == Exclusive) {
+      if (!found && !cachesim_remove(&LL, tag))
+         missed |= MISSED_LL;
+      if (victim != INVALID_TAG)
+         cachesim_insert(&LL, victim);
+   } else {
+      if (cachesim_setref_is_miss(&LL, tag & LL.sets_min_1, tag, &evicted))
+         missed |= MISSED_LL;
+      if (LL_policy == Inclusive && evicted != INVALID_TAG)
+         cachesim_remove_from_cores(evicted);
+   }
+   return missed;
+}
+
+/* Adds one miss to the counter of each level in missed. */
+__attribute__((always_inline))
+static __inline__
+void cachesim_count_misses(UInt missed, ULong* m1, ULong* mM, ULong* mL)
+{
+   if (missed) {
+      (*m1)++;
+      if (missed & MISSED_ML)
+         (*mM)++;
+      if (missed & MISSED_LL)
+         (*mL)++;
+   }
 }
 
 __attribute__((always_inline))
 static __inline__
-Bool cachesim_ref_is_miss(cache_t2* c, Addr a, UChar size)
+UInt cachesim_ref_missed(cache_t2* c, Addr a, UChar size)
 {
    /* A memory block has the size of a cache line */
    UWord block1 =  a         >> c->line_size_bits;
    UWord block2 = (a+size-1) >> c->line_size_bits;
    UInt  set1   = block1 & c->sets_min_1;
+   UWord victim;
+   UInt  missed = 0;
 
    /* Tags used in real caches are minimal to save space.
     * As the last bits of the block number of addresses mapping
@@ -137,9 +363,12 @@ Bool cachesim_ref_is_miss(cache_t2* c, Addr a, UChar size)
     */
    UWord tag1   = block1;
 
+   if (cachesim_setref_is_miss(c, set1, tag1, &victim))
+      missed = MISSED_L1 | cachesim_lower_ref(a, victim);
+
    /* Access entirely within line. */
    if (block1 == block2)
-      return cachesim_setref_is_miss(c, set1, tag1);
+      return missed;
 
    /* Access straddles two lines. */
    else if (block1 + 1 == block2) {
@@ -147,69 +376,182 @@ Bool cachesim_ref_is_miss(cache_t2* c, Addr a, UChar size)
       UWord tag2 = block2;
 
       /* always do both, as state is updated as side effect */
-      if (cachesim_setref_is_miss(c, set1, tag1)) {
-         cachesim_setref_is_miss(c, set2, tag2);
-         return True;
-      }
-      return cachesim_setref_is_miss(c, set2, tag2);
+      if (cachesim_setref_is_miss(c, set2, tag2, &victim))
+         missed |= MISSED_L1
+                   | cachesim_lower_ref(block2 << c->line_size_bits, victim);
+      return missed;
    }
    VG_(printf)("addr: %lx  size: %u  blocks: %lu %lu",
                a, size, block1, block2);
    VG_(tool_panic)("item straddles more than two cache sets");
    /* not reached */
-   return True;
-}
-
-
-static cache_t2 LL;
-static cache_t2 I1;
-static cache_t2 D1;
-
-static void cachesim_initcaches(cache_t I1c, cache_t D1c, cache_t LLc)
-{
-   cachesim_initcache(I1c, &I1);
-   cachesim_initcache(D1c, &D1);
-   cachesim_initcache(LLc, &LL);
+   return missed;
 }
 
 __attribute__((always_inline))
 static __inline__
-void cachesim_I1_doref_Gen(Addr a, UChar size, ULong* m1, ULong *mL)
+void cachesim_I1_doref_Gen(Addr a, UChar size,
+                           ULong* m1, ULong* mM, ULong *mL)
 {
-   if (cachesim_ref_is_miss(&I1, a, size)) {
-      (*m1)++;
-      if (cachesim_ref_is_miss(&LL, a, size))
-         (*mL)++;
-   }
+   cachesim_count_misses(cachesim_ref_missed(&I1, a, size), m1, mM, mL);
 }
 
 // common special case IrNoX
 __attribute__((always_inline))
 static __inline__
-void cachesim_I1_doref_NoX(Addr a, UChar size, ULong* m1, ULong *mL)
+void cachesim_I1_doref_NoX(Addr a, UChar size,
+                           ULong* m1, ULong* mM, ULong *mL)
 {
    UWord block  = a >> I1.line_size_bits;
    UInt  I1_set = block & I1.sets_min_1;
+   UWord victim;
 
    // use block as tag
-   if (cachesim_setref_is_miss(&I1, I1_set, block)) {
-      UInt  LL_set = block & LL.sets_min_1;
-      (*m1)++;
-      // can use block as tag as L1I and LL cache line sizes are equal
-      if (cachesim_setref_is_miss(&LL, LL_set, block))
-         (*mL)++;
+   if (cachesim_setref_is_miss(&I1, I1_set, block, &victim))
+      cachesim_count_misses(MISSED_L1 | cachesim_lower_ref(a, victim),
+                            m1, mM, mL);
+}
+
+/* Coherence between the private caches of the cores follows MESI: a
+   core must hold a block alone (E or M) to write it, and any number of
+   cores may share a block (S) to read it.  The directory records, for
+   every block, the cores that may hold it (a superset: evictions are
+   not reported to it), and the cores whose copy was invalidated by a
+   write of another core.  The next miss of such a core on the block is
+   a coherence miss.  The directory is split in chunks of
+   DIR_CHUNK_SIZE consecutive blocks, created when first used.
+   Coherence is only simulated for data references. */
+#define DIR_CHUNK_BITS  10
+#define DIR_CHUNK_SIZE  (1 << DIR_CHUNK_BITS)
+
+typedef struct _DirChunk {
+   struct _DirChunk* next;
+   UWord             key;                         /* block >> DIR_CHUNK_BITS */
+   UInt              sharers[DIR_CHUNK_SIZE];     /* bit n: core n */
+   UInt              invalidated[DIR_CHUNK_SIZE]; /* bit n: core n */
+} DirChunk;
+
+static VgHashTable* dir_chunks     = NULL;
+static DirChunk*    dir_last_chunk = NULL;
+
+static DirChunk* dir_get_chunk(UWord block)
+{
+   UWord     key = block >> DIR_CHUNK_BITS;
+   DirChunk* chunk;
+
+   if (LIKELY(dir_last_chunk != NULL && dir_last_chunk->key == key))
+      return dir_last_chunk;
+
+   if (dir_chunks == NULL)
+      dir_chunks = VG_(HT_construct)("cg.sim.dgc.1");
+   chunk = VG_(HT_lookup)(dir_chunks, key);
+   if (chunk == NULL) {
+      chunk = VG_(calloc)("cg.sim.dgc.2", 1, sizeof(DirChunk));
+      chunk->key = key;
+      VG_(HT_add_node)(dir_chunks, chunk);
    }
+   dir_last_chunk = chunk;
+   return chunk;
 }
 
+/* Flags returned by cachesim_D1_block_coherent, on top of MISSED_*. */
+#define MISSED_COHERENCE  8   /* the D1 miss was a coherence miss */
+#define INVALIDATED       16  /* the write invalidated other cores' copies */
+
+/* Reference of the current core to the D1 block holding address a, in a
+   multi-core simulation.  A write (or modify) takes the block away from
+   the other cores.  Returns MISSED_* flags, plus MISSED_COHERENCE and
+   INVALIDATED. */
+static UInt cachesim_D1_block_coherent(Addr a, Bool is_write)
+{
+   UWord     block = a >> D1.line_size_bits;
+   UInt      me    = 1u << curr_core;
+   UWord*    owned = &cores[curr_core].owned[block & (N_OWNED - 1)];
+   DirChunk* chunk = NULL;
+   UInt      flags = 0;
+   UInt      i, others;
+   UWord     victim;
+   Int       c;
+
+   if (cachesim_setref_is_miss(&D1, block & D1.sets_min_1, block, &victim)) {
+      chunk = dir_get_chunk(block);
+      i     = block & (DIR_CHUNK_SIZE - 1);
+      if (chunk->invalidated[i] & me) {
+         flags |= MISSED_COHERENCE;
+         chunk->invalidated[i] &= ~me;
+      }
+      /* Reading the block makes it shared: no other core owns it any
+         more. */
+      others = chunk->sharers[i] & ~me;
+      for (c = 0; others != 0; c++, others >>= 1) {
+         if ((others & 1) && cores[c].owned[block & (N_OWNED - 1)] == block)
+            cores[c].owned[block & (N_OWNED - 1)] = INVALID_TAG;
+      }
+      chunk->sharers[i] |= me;
+      flags |= MISSED_L1 | cachesim_lower_ref(a, victim);
+   }
+
+   if (is_write && *owned != block) {
+      if (chunk == NULL)
+         chunk = dir_get_chunk(block);
+      i      = block & (DIR_CHUNK_SIZE - 1);
+      others = chunk->sharers[i] & ~me;
+      for (c = 0; others != 0; c++, others >>= 1) {
+         Bool had;
+         if (!(others & 1))
+            continue;
+         had = cachesim_remove_from(&D1, cores[c].D1_tags, block);
+         if (ML_present)
+            had |= cachesim_remove_from(&ML, cores[c].ML_tags, block);
+         if (had) {
+            chunk->invalidated[i] |= 1u << c;
+            flags |= INVALIDATED;
+         }
+         if (cores[c].owned[block & (N_OWNED - 1)] == block)
+            cores[c].owned[block & (N_OWNED - 1)] = INVALID_TAG;
+      }
+      chunk->sharers[i] = me;
+      *owned = block;
+   }
+   return flags;
+}
+
+/* Multi-core version of cachesim_D1_doref. */
+static void cachesim_D1_doref_coherent(Addr a, UChar size, Bool is_write,
+                                       ULong* m1, ULong* mM, ULong* mL,
+                                       ULong* mc, ULong* inv)
+{
+   UWord block1 =  a         >> D1.line_size_bits;
+   UWord block2 = (a+size-1) >> D1.line_size_bits;
+   UInt  flags;
+
+   flags = cachesim_D1_block_coherent(a, is_write);
+   if (block1 != block2)
+      flags |= cachesim_D1_block_coherent(block2 << D1.line_size_bits,
+                                          is_write);
+
+   cachesim_count_misses(flags, m1, mM, mL);
+   if (flags & MISSED_COHERENCE)
+      (*mc)++;
+   if (flags & INVALIDATED)
+      (*inv)++;
+}
+
+/* is_write tells if the reference needs the block for itself, ie. is a
+   write or a modify.  mc counts the coherence misses among the D1
+   misses, and inv the references that invalidated the block in other
+   cores; they are only used in multi-core simulations, and inv is not
+   used if is_write is False. */
 __attribute__((always_inline))
 static __inline__
-void cachesim_D1_doref(Addr a, UChar size, ULong* m1, ULong *mL)
+void cachesim_D1_doref(Addr a, UChar size, Bool is_write,
+                       ULong* m1, ULong* mM, ULong *mL,
+                       ULong* mc, ULong* inv)
 {
-   if (cachesim_ref_is_miss(&D1, a, size)) {
-      (*m1)++;
-      if (cachesim_ref_is_miss(&LL, a, size))
-         (*mL)++;
-   }
+   if (UNLIKELY(n_cores > 1))
+      cachesim_D1_doref_coherent(a, size, is_write, m1, mM, mL, mc, inv);
+   else
+      cachesim_count_misses(cachesim_ref_missed(&D1, a, size), m1, mM, mL);
 }
 
 /* Check for special case IrNoX. Called at instrumentation time.
@@ -0,0 +1,62 @@
+/* Two threads each increment their own counter.  With --cores=2 they run
+   on different simulated cores.  When the counters share a line ("shared"
+   argument), the first increment after each thread switch is a coherence
+   miss, and its write invalidates the other core's copy.  When they are
+   a line apart ("padded" argument), no increment ever misses or
+   invalidates on coherence grounds. */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#define N 2000000
+
+static struct {
+   volatile long a;
+   volatile long b;
+} shared __attribute__((aligned(64)));
+
+static struct {
+   volatile long a __attribute__((aligned(64)));
+   volatile long b __attribute__((aligned(64)));
+} padded;
+
+/* The counting loop must not touch anything but the counter, so this
+   file is built with -O2 and the loop keeps everything in registers. */
+__attribute__((noinline))
+static void count(volatile long* p)
+{
+   long i;
+
+   for (i = 0; i < N; i++)
+      (*p)++;
+}
+
+static void* thread_fn(void* p)
+{
+   count(p);
+   return NULL;
+}
+
+int main(int argc, char** argv)
+{
+   volatile long *a, *b;
+   pthread_t ta, tb;
+
+   if (argc == 2 && strcmp(argv[1], "shared") == 0) {
+      a = &shared.a;
+      b = &shared.b;
+   } else if (argc == 2 && strcmp(argv[1], "padded") == 0) {
+      a = &padded.a;
+      b = &padded.b;
+   } else {
+      fprintf(stderr, "usage: false_sharing shared|padded\n");
+      return 1;
+   }
+   pthread_create(&ta, NULL, thread_fn, (void*)a);
+   pthread_create(&tb, NULL, thread_fn, (void*)b);
+   pthread_join(ta, NULL);
+   pthread_join(tb, NULL);
+   printf("%ld %ld\n", *a, *b);
+   return 0;
+}
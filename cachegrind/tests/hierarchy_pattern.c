@@ -0,0 +1,174 @@
+/* Deterministic data access patterns for the cache hierarchy tests.
+   They are meant to be run with the caches of hierarchy_*.vgtest:
+     D1: 4 sets of 2 ways, ML: 64 sets of 4 ways, LL: 256 sets of 8 ways,
+   all with 64 B lines.  Each pattern_* function only touches memory that
+   nothing else touched, and does not use the stack, so that its misses
+   only depend on the pattern and on the simulated policies.  The lines
+   of a pattern are chosen in a set which holds none of the lines of the
+   code, nor of the stack. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#define LINE       64
+#define D1_SETS    4
+#define LL_SETS    256
+#define ML_SETS    64
+#define WAY_STRIDE (LL_SETS * LINE)  /* maps to the same set everywhere */
+
+typedef volatile unsigned char vuchar;
+
+/* The patterns sum what they load, as Valgrind drops unused loads. */
+
+static inline unsigned cycle(vuchar* p, int n)
+{
+   unsigned sum = 0;
+   int pass, i;
+
+   for (pass = 0; pass < 3; pass++)
+      for (i = 0; i < n; i++)
+         sum += p[i * WAY_STRIDE];
+   return sum;
+}
+
+/* 3 passes over 5 lines of the same set: more than D1 and ML can hold
+   each, but not more than D1 and an exclusive ML together. */
+__attribute__((noinline))
+static unsigned pattern_ml_cycle(vuchar* p)
+{
+   return cycle(p, 5);
+}
+
+/* 3 passes over 10 lines of the same set: more than ML and LL can hold
+   each, but not more than ML and an exclusive LL together. */
+__attribute__((noinline))
+static unsigned pattern_ll_cycle(vuchar* p)
+{
+   return cycle(p, 10);
+}
+
+/* A line kept hot in D1, while 20 other lines of its set stream through
+   the caches below.  An inclusive ML or LL evicts it, and so takes it
+   out of D1 as well. */
+__attribute__((noinline))
+static unsigned pattern_hot(vuchar* p)
+{
+   unsigned sum = 0;
+   int i;
+
+   for (i = 1; i <= 20; i++) {
+      sum += p[0];
+      sum += p[i * WAY_STRIDE];
+   }
+   return sum;
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+/* An access straddling a line which hits in D1 but is no longer in LL,
+   and a line which misses in D1 but is still in LL.  Only the second
+   line goes to LL. */
+__attribute__((noinline))
+static unsigned pattern_unaligned(vuchar* p)
+{
+   unsigned sum = 0;
+   int i;
+
+   sum += p[LINE];                     /* the next line, in set s+1 */
+   sum += p[LINE + 4 * LINE];          /* 2 lines in the same D1 set */
+   sum += p[LINE + 8 * LINE];          /* evict it from D1 only */
+   for (i = 1; i <= 9; i++) {          /* evict line 0 from LL only */
+      sum += p[0];
+      sum += p[i * WAY_STRIDE];
+   }
+   sum += *(volatile uint64_t*)(p + LINE - 4);
+   return sum;
+}
+#endif
+
+int main(int argc, char** argv);
+
+/* Returns whether the line holding a is in the same ML or LL set as the
+   line holding b, within n bytes after b. */
+static int same_set(uintptr_t a, uintptr_t b, uintptr_t n)
+{
+   uintptr_t l;
+
+   for (l = b / LINE; l <= (b + n) / LINE; l++)
+      if ((a / LINE) % ML_SETS == l % ML_SETS
+          || (a / LINE) % LL_SETS == l % LL_SETS)
+         return 1;
+   return 0;
+}
+
+/* Returns a pointer into region to a line which, like the following lines
+   whose bit is set in lines, is in a set away from the code and the
+   stack.  The pattern_* functions return through the same stack slot as
+   this one, which must not share a D1 set with them either. */
+static vuchar* pick_line(unsigned char* region, unsigned lines)
+{
+   const uintptr_t code[] = {
+      (uintptr_t)pattern_ml_cycle, (uintptr_t)pattern_ll_cycle,
+      (uintptr_t)pattern_hot,
+#if defined(__i386__) || defined(__x86_64__)
+      (uintptr_t)pattern_unaligned,
+#endif
+      (uintptr_t)pick_line, (uintptr_t)main,
+   };
+   uintptr_t stack = (uintptr_t)__builtin_frame_address(0) + sizeof(void*);
+   uintptr_t base  = ((uintptr_t)region + WAY_STRIDE - 1)
+                     & ~(uintptr_t)(WAY_STRIDE - 1);
+   int set, i, l, ok;
+
+   for (set = 0; set < LL_SETS; set++) {
+      ok = 1;
+      for (l = 0; l < 32 && ok; l++) {
+         uintptr_t a = base + (set + l) * LINE;
+         if (!(lines & (1u << l)))
+            continue;
+         for (i = 0; i < (int)(sizeof(code) / sizeof(code[0])); i++)
+            if (same_set(a, code[i], 512))
+               ok = 0;
+         if (same_set(a, stack - 512, 1024)
+             || (a / LINE) % D1_SETS == (stack / LINE) % D1_SETS)
+            ok = 0;
+      }
+      if (ok)
+         return (vuchar*)(base + set * LINE);
+   }
+   fprintf(stderr, "no suitable cache set\n");
+   exit(1);
+}
+
+int main(int argc, char** argv)
+{
+   const size_t size = 48 * WAY_STRIDE;
+   unsigned char* region;
+   unsigned sum = 0;
+
+   if (argc != 2) {
+      fprintf(stderr, "usage: hierarchy_pattern policies|unaligned\n");
+      return 1;
+   }
+   region = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (region == MAP_FAILED) {
+      perror("mmap");
+      return 1;
+   }
+   if (strcmp(argv[1], "policies") == 0) {
+      sum += pattern_ml_cycle(pick_line(region, 1));
+      sum += pattern_ll_cycle(pick_line(region + 8 * WAY_STRIDE, 1));
+      sum += pattern_hot(pick_line(region + 20 * WAY_STRIDE, 1));
+   }
+#if defined(__i386__) || defined(__x86_64__)
+   else if (strcmp(argv[1], "unaligned") == 0) {
+      sum += pattern_unaligned(pick_line(region,
+                                         1 << 0 | 1 << 1 | 1 << 5 | 1 << 9));
+   }
+#endif
+   /* Fresh pages read as zero. */
+   return sum != 0;
+}
@@ -200,6 +200,14 @@ SysRes ML_(am_do_munmap_NO_NOTIFY)(Addr start, SizeT length)
    return VG_(do_syscall2)(__NR_munmap, (UWord)start, length );
 }
 
+#if defined(VGO_linux)
+SysRes ML_(am_do_discard_NO_NOTIFY)(Addr start, SizeT length)
+{
+   return VG_(do_syscall3)(__NR_madvise, (UWord)start, length,
+                           VKI_MADV_DONTNEED );
+}
+#endif
+
 #if HAVE_MREMAP
 /* The following are used only to implement mremap(). */
 
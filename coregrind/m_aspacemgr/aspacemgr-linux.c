@@ -2846,6 +2846,39 @@ SysRes VG_(am_munmap_valgrind)( Addr start, SizeT len )
    return r;
 }
 
+/* Let (start,len) denote a page-aligned area of the client heap.
+   Tell the kernel its contents are no longer needed, so that the
+   pages stop being resident; they read back as zeroes.  The segment
+   array is unchanged.  Returns False, doing nothing, if the area is
+   not entirely client heap, or if this is not supported. */
+
+Bool VG_(am_discard_client_heap_pages)( Addr start, SizeT len )
+{
+#  if defined(VGO_linux)
+   Int    i, iLo, iHi;
+   SysRes sres;
+
+   if (len == 0)
+      return True;
+   if (start + len < start)
+      return False;
+   if (!VG_IS_PAGE_ALIGNED(start) || !VG_IS_PAGE_ALIGNED(len))
+      return False;
+
+   iLo = find_nsegment_idx(start);
+   iHi = find_nsegment_idx(start + len - 1);
+   for (i = iLo; i <= iHi; i++) {
+      if (nsegments[i].kind != SkAnonC || !nsegments[i].isCH)
+         return False;
+   }
+
+   sres = ML_(am_do_discard_NO_NOTIFY)( start, len );
+   return !sr_isError(sres);
+#  else
+   return False;
+#  endif
+}
+
 /* Let (start,len) denote an area within a single Valgrind-owned
   segment (anon or file).  Change the ownership of [start, start+len)
   to the client instead.  Fails if (start,len) does not denote a
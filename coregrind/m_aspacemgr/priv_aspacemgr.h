@@ -92,6 +92,11 @@ extern UInt   ML_(am_sprintf) ( HChar* buf, const HChar *format, ... );
 /* wrapper for munmap */
 extern SysRes ML_(am_do_munmap_NO_NOTIFY)(Addr start, SizeT length);
 
+#if defined(VGO_linux)
+/* wrapper for madvise(MADV_DONTNEED) */
+extern SysRes ML_(am_do_discard_NO_NOTIFY)(Addr start, SizeT length);
+#endif
+
 /* wrapper for the ghastly 'mremap' syscall */
 extern SysRes ML_(am_do_extend_mapping_NO_NOTIFY)( 
                  Addr  old_addr, 
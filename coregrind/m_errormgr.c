@@ -39,6 +39,7 @@
 #include "pub_core_libcfile.h"
 #include "pub_core_libcprint.h"
 #include "pub_core_libcproc.h"         // For VG_(getpid)()
+#include "pub_core_machine.h"          // VG_(get_IP), VG_(get_SP)
 #include "pub_core_seqmatch.h"
 #include "pub_core_mallocfree.h"
 #include "pub_core_options.h"
@@ -67,15 +68,40 @@
 #define M_COLLECT_NO_ERRORS_AFTER_FOUND 10000000
 
 /* The list of error contexts found, both suppressed and unsuppressed.
-   Initially empty, and grows as errors are detected. */
+   Initially empty, and grows as errors are detected.  The list is kept
+   in most-recently-seen-first order. */
 static Error* errors = NULL;
 
+/* The same errors, indexed by err_hash() so that VG_(maybe_record_error)
+   does not have to compare a new error against all the known ones.
+   errors_ht_size is a power of 2, and the table is doubled when it holds
+   more errors than buckets. */
+static Error** errors_ht      = NULL;
+static UInt    errors_ht_size = 0;
+static UInt    errors_ht_used = 0;
+#define ERRORS_HT_INITIAL_SIZE 256
+
 /* The list of suppression directives, as read from the specified
    suppressions file.  Note that the list gets rearranged as a result
    of the searches done by is_suppressible_error(). */
 static Supp* suppressions = NULL;
 static Bool load_suppressions_called = False;
 
+/* The same suppressions, indexed on their first frame, so that
+   is_suppressible_error() only looks at the suppressions that can match
+   the innermost frame of an error.  A suppression whose first frame is a
+   fun: or obj: name without wildcards is in the supp_index bucket of
+   that name.  The others (wildcards, src: or "..." first frame) are in
+   supp_wild.  Each chain is kept in the order of the suppressions list,
+   which is also decreasing 'stamp' order: the stamp of a suppression is
+   bumped each time it moves to the head of the list. */
+#define SUPP_INDEX_SIZE 2048
+static Supp* supp_index[SUPP_INDEX_SIZE];
+static Supp* supp_wild = NULL;
+static UInt  supp_stamp = 0;
+static UInt  n_supp_indexed_fun = 0;
+static UInt  n_supp_indexed_obj = 0;
+
 /* Running count of unsuppressed errors detected. */
 static UInt n_errs_found = 0;
 
@@ -104,6 +130,10 @@ static UWord em_errlist_searches = 0;
    searching. */
 static UWord em_errlist_cmps = 0;
 
+/* Stats: number of errors counted by VG_(maybe_record_error_at_ip)
+   without searching the error list. */
+static UWord em_errlist_ip_hits = 0;
+
 /* Stats: number of searches of the suppression list initiated. */
 static UWord em_supplist_searches = 0;
 
@@ -126,6 +156,11 @@ static UWord em_supplist_cmps = 0;
 */
 struct _Error {
    struct _Error* next;
+   // Previous error in the errors list, and next error in the same
+   // errors_ht bucket.
+   struct _Error* prev;
+   struct _Error* hash_next;
+   UWord hash;
    // Unique tag.  This gives the error a unique identity (handle) by
    // which it can be referred to afterwords.  Currently only used for
    // XML printing.
@@ -225,6 +260,12 @@ typedef
    (0..)) for 'skind'. */
 struct _Supp {
    struct _Supp* next;
+   // Previous suppression in the suppressions list, next suppression in
+   // the same supp_index bucket (or in supp_wild), and position in the
+   // suppressions list (higher is nearer the head).
+   struct _Supp* prev;
+   struct _Supp* index_next;
+   UInt stamp;
    Int count;     // The number of times this error has been suppressed.
    HChar* sname;  // The name by which the suppression is referred to.
 
@@ -315,6 +356,53 @@ static Bool eq_Error ( VgRes res, const Error* e1, const Error* e2 )
 }
 
 
+/* Hash an error so that errors equal according to eq_Error have the same
+   hash, whatever the resolution used.  Only the error kind and the top
+   two callers (as compared with Vg_LowRes) are used: the tool specific
+   part of the error is compared by eq_Error on the few errors in the
+   same bucket. */
+static UWord err_hash ( const Error* err )
+{
+   Addr* ips   = VG_(get_ExeContext_StackTrace)( err->where );
+   Int   n_ips = VG_(get_ExeContext_n_ips)( err->where );
+   UWord h     = (UWord)err->ekind;
+   Int   i;
+
+   for (i = 0; i < 2 && i < n_ips; i++)
+      h = (h ^ ips[i]) * 0x9E3779B1UL + i;
+   return h ^ (h >> 15);
+}
+
+static void errors_ht_add ( Error* err )
+{
+   UInt i;
+
+   if (errors_ht_used >= errors_ht_size) {
+      UInt    new_size = errors_ht_size == 0
+                            ? ERRORS_HT_INITIAL_SIZE : 2 * errors_ht_size;
+      Error** new_ht   = VG_(calloc)("errormgr.eha.1",
+                                     new_size, sizeof(Error*));
+      for (i = 0; i < errors_ht_size; i++) {
+         Error* e = errors_ht[i];
+         while (e != NULL) {
+            Error* e_next = e->hash_next;
+            UInt   b      = e->hash & (new_size - 1);
+            e->hash_next = new_ht[b];
+            new_ht[b]    = e;
+            e = e_next;
+         }
+      }
+      if (errors_ht != NULL)
+         VG_(free)(errors_ht);
+      errors_ht      = new_ht;
+      errors_ht_size = new_size;
+   }
+   i = err->hash & (errors_ht_size - 1);
+   err->hash_next = errors_ht[i];
+   errors_ht[i]   = err;
+   errors_ht_used++;
+}
+
 /* Helper functions for suppression generation: print a single line of
    a suppression pseudo-stack-trace, either in XML or text mode.  It's
    important that the behaviour of these two functions exactly
@@ -657,6 +745,8 @@ void construct_error ( Error* err, ThreadId tid, ErrorKind ekind, Addr a,
    /* Core-only parts */
    err->unique   = unique_counter++;
    err->next     = NULL;
+   err->prev     = NULL;
+   err->hash_next = NULL;
    err->supp     = NULL;
    err->count    = 1;
    err->tid      = tid;
@@ -677,16 +767,40 @@ void construct_error ( Error* err, ThreadId tid, ErrorKind ekind, Addr a,
 
 
 
-/* Top-level entry point to the error management subsystem.
-   All detected errors are notified here; this routine decides if/when the
-   user should see the error. */
-void VG_(maybe_record_error) ( ThreadId tid, 
-                               ErrorKind ekind, Addr a, 
-                               const HChar* s, void* extra )
+/* Count another occurrence of the recorded error p. */
+static void count_error_again ( Error* p )
+{
+   p->count++;
+   if (p->supp != NULL) {
+      /* Deal correctly with suppressed errors. */
+      p->supp->count++;
+      n_errs_suppressed++;
+   } else {
+      n_errs_found++;
+   }
+
+   /* Move p to the front of the list.  This allows to print the
+      last error (see VG_(show_last_error). */
+   if (p->prev != NULL) {
+      vg_assert(p->prev->next == p);
+      p->prev->next = p->next;
+      if (p->next != NULL)
+         p->next->prev = p->prev;
+      p->prev      = NULL;
+      p->next      = errors;
+      errors->prev = p;
+      errors       = p;
+   }
+}
+
+/* Decides if/when the user should see the error.  Returns the recorded
+   error that this one was counted in, or NULL if it was ignored. */
+static Error* maybe_record_error_wrk ( ThreadId tid,
+                                       ErrorKind ekind, Addr a,
+                                       const HChar* s, void* extra )
 {
           Error  err;
           Error* p;
-          Error* p_prev;
           UInt   extra_size;
           VgRes  exe_res          = Vg_MedRes;
    static Bool   stopping_message = False;
@@ -728,13 +842,13 @@ void VG_(maybe_record_error) ( ThreadId tid,
          VG_(umsg)("\n");
          stopping_message = True;
       }
-      return;
+      return NULL;
    }
 
    /* Ignore it if error acquisition is disabled for this thread. */
    { ThreadState* tst = VG_(get_ThreadState)(tid);
      if (tst->err_disablement_level > 0)
-        return;
+        return NULL;
    }
 
    /* After M_COLLECT_ERRORS_SLOWLY_AFTER different errors have
@@ -758,35 +872,17 @@ void VG_(maybe_record_error) ( ThreadId tid,
 
    /* First, see if we've got an error record matching this one. */
    em_errlist_searches++;
-   p       = errors;
-   p_prev  = NULL;
+   err.hash = err_hash(&err);
+   p        = errors_ht == NULL
+                 ? NULL : errors_ht[err.hash & (errors_ht_size - 1)];
    while (p != NULL) {
       em_errlist_cmps++;
       if (eq_Error(exe_res, p, &err)) {
          /* Found it. */
-         p->count++;
-	 if (p->supp != NULL) {
-            /* Deal correctly with suppressed errors. */
-            p->supp->count++;
-            n_errs_suppressed++;	 
-         } else {
-            n_errs_found++;
-         }
-
-         /* Move p to the front of the list so that future searches
-            for it are faster. It also allows to print the last
-            error (see VG_(show_last_error). */
-         if (p_prev != NULL) {
-            vg_assert(p_prev->next == p);
-            p_prev->next = p->next;
-            p->next      = errors;
-            errors       = p;
-	 }
-
-         return;
+         count_error_again(p);
+         return p;
       }
-      p_prev = p;
-      p      = p->next;
+      p = p->hash_next;
    }
 
    /* Didn't see it.  Copy and add. */
@@ -840,7 +936,10 @@ void VG_(maybe_record_error) ( ThreadId tid,
 
    p->next = errors;
    p->supp = is_suppressible_error(&err);
+   if (errors != NULL)
+      errors->prev = p;
    errors  = p;
+   errors_ht_add(p);
    if (p->supp == NULL) {
       /* update stats */
       n_err_contexts++;
@@ -853,6 +952,107 @@ void VG_(maybe_record_error) ( ThreadId tid,
       n_errs_suppressed++;
       p->supp->count++;
    }
+   return p;
+}
+
+/* Top-level entry point to the error management subsystem.
+   All detected errors are notified here. */
+void VG_(maybe_record_error) ( ThreadId tid,
+                               ErrorKind ekind, Addr a,
+                               const HChar* s, void* extra )
+{
+   (void)maybe_record_error_wrk(tid, ekind, a, s, extra);
+}
+
+/* With --fast-error-counting=yes, errors reported by
+   VG_(maybe_record_error_at_ip), indexed by the IP, SP and caller of
+   the reporting thread and by the tool's key.  An entry is only used
+   once the error list search has found the same error for it
+   ERRORS_AT_IP_TRUST times in a row, so that code reporting errors
+   with different callers further up keeps going through the search.
+   After that, every ERRORS_AT_IP_RECHECK-th hit searches again.
+   Suppressed errors are never entered: a suppression can depend on
+   any of the callers. */
+#define N_ERRORS_AT_IP       1024  /* must be a power of 2 */
+#define ERRORS_AT_IP_TRUST     16
+#define ERRORS_AT_IP_RECHECK  256  /* must be a power of 2 */
+
+typedef
+   struct {
+      Addr      ip;
+      Addr      sp;
+      Addr      caller;
+      UWord     key;
+      ErrorKind ekind;
+      UInt      epoch;
+      UInt      confirmed;
+      UInt      hits;
+      Error*    err;
+   }
+   ErrorAtIP;
+
+static ErrorAtIP errors_at_ip[N_ERRORS_AT_IP];
+
+void VG_(maybe_record_error_at_ip) ( ThreadId tid,
+                                     ErrorKind ekind, Addr a,
+                                     const HChar* s, void* extra,
+                                     UWord key )
+{
+   Addr       ips[2];
+   Addr       ip, sp, caller;
+   UInt       epoch;
+   ErrorAtIP* ent;
+   Error*     p;
+   Bool       same;
+
+   if (LIKELY(!VG_(clo_fast_error_counting))) {
+      (void)maybe_record_error_wrk(tid, ekind, a, s, extra);
+      return;
+   }
+
+   /* Unwinding a single frame is much cheaper than the full stack
+      trace of an error. */
+   ip     = VG_(get_IP)(tid);
+   sp     = VG_(get_SP)(tid);
+   caller = VG_(get_StackTrace)(tid, ips, 2, NULL, NULL, 0) == 2 ? ips[1] : 0;
+   epoch  = VG_(current_DiEpoch)().n;
+   ent = &errors_at_ip[((ip ^ (ip >> 12) ^ sp ^ caller ^ (caller >> 12)
+                         ^ (key * 0x9E3779B1UL) ^ (UWord)ekind) >> 2)
+                       & (N_ERRORS_AT_IP - 1)];
+   same = ent->err != NULL && ent->ip == ip && ent->sp == sp
+          && ent->caller == caller && ent->key == key
+          && ent->ekind == ekind && ent->epoch == epoch;
+   if (same
+       && ent->confirmed >= ERRORS_AT_IP_TRUST
+       && (++ent->hits & (ERRORS_AT_IP_RECHECK - 1)) != 0
+       && !(VG_(clo_error_limit)
+            && (n_errs_shown >= M_COLLECT_NO_ERRORS_AFTER_SHOWN
+                || n_errs_found >= M_COLLECT_NO_ERRORS_AFTER_FOUND))
+       && VG_(get_ThreadState)(tid)->err_disablement_level == 0) {
+      em_errlist_ip_hits++;
+      count_error_again(ent->err);
+      return;
+   }
+
+   p = maybe_record_error_wrk(tid, ekind, a, s, extra);
+   if (p == NULL || p->supp != NULL) {
+      ent->err = NULL;
+      return;
+   }
+   if (same && p == ent->err) {
+      if (ent->confirmed < ERRORS_AT_IP_TRUST)
+         ent->confirmed++;
+   } else {
+      ent->ip        = ip;
+      ent->sp        = sp;
+      ent->caller    = caller;
+      ent->key       = key;
+      ent->ekind     = ekind;
+      ent->epoch     = epoch;
+      ent->confirmed = 0;
+      ent->hits      = 0;
+      ent->err       = p;
+   }
 }
 
 /* Second top-level entry point to the error management subsystem, for
@@ -1270,6 +1470,47 @@ static Bool tool_name_present(const HChar *name, const HChar *names)
    return found;
 }
 
+/* Hash of a fun: or obj: name for supp_index. */
+static UInt supp_name_hash ( SuppLocTy ty, const HChar* name )
+{
+   UInt h = (UInt)ty;
+   while (*name)
+      h = h * 31 + (UChar)*name++;
+   return (h ^ (h >> 11)) & (SUPP_INDEX_SIZE - 1);
+}
+
+/* The chain in which su is indexed. */
+static Supp** supp_chain ( const Supp* su )
+{
+   const SuppLoc* first = &su->callers[0];
+   if ((first->ty == FunName || first->ty == ObjName)
+       && first->name_is_simple_str)
+      return &supp_index[supp_name_hash(first->ty, first->name)];
+   return &supp_wild;
+}
+
+/* Add su at the head of the suppressions list, and index it. */
+static void add_suppression ( Supp* su )
+{
+   Supp** chain = supp_chain(su);
+
+   su->stamp = ++supp_stamp;
+   su->prev  = NULL;
+   su->next  = suppressions;
+   if (suppressions != NULL)
+      suppressions->prev = su;
+   suppressions = su;
+
+   su->index_next = *chain;
+   *chain = su;
+   if (chain != &supp_wild) {
+      if (su->callers[0].ty == FunName)
+         n_supp_indexed_fun++;
+      else
+         n_supp_indexed_obj++;
+   }
+}
+
 /* Read suppressions from the file specified in 
    VG_(clo_suppressions)[clo_suppressions_i]
    and place them in the suppressions list.  If there's any difficulty
@@ -1458,8 +1699,7 @@ static void load_one_suppressions_file ( Int clo_suppressions_i )
          supp->callers[i] = tmp_callers[i];
       }
 
-      supp->next = suppressions;
-      suppressions = supp;
+      add_suppression(supp);
    }
    VG_(free)(buf);
    VG_(close)(fd);
@@ -1491,6 +1731,10 @@ void VG_(load_suppressions) ( void )
 {
    Int i;
    suppressions = NULL;
+   supp_wild    = NULL;
+   VG_(memset)(supp_index, 0, sizeof(supp_index));
+   n_supp_indexed_fun = 0;
+   n_supp_indexed_obj = 0;
    load_suppressions_called = True;
    for (i = 0; i < VG_(sizeXA)(VG_(clo_suppressions)); i++) {
       if (VG_(clo_verbosity) > 1) {
@@ -1959,8 +2203,11 @@ Bool supp_matches_error(const Supp* su, const Error* err)
 */
 static Supp* is_suppressible_error ( const Error* err )
 {
-   Supp* su;
-   Supp* su_prev;
+   Supp*  su;
+   Supp** chain[3];
+   Supp*  cur[3];
+   Supp*  prev[3];
+   Int    c;
 
    IPtoFunOrObjCompleter ip2fo;
    /* Conceptually, ip2fo contains an array of function names and an array of
@@ -1997,26 +2244,69 @@ static Supp* is_suppressible_error ( const Error* err )
    /* See if the error context matches any suppression. */
    if (DEBUG_ERRORMGR || VG_(debugLog_getLevel)() >= 4)
      VG_(dmsg)("errormgr matching begin\n");
-   su_prev = NULL;
-   for (su = suppressions; su != NULL; su = su->next) {
+   /* Only the suppressions indexed under the fun or obj name of the
+      innermost frame, and the wildcard ones, can match.  Walk these
+      chains together in decreasing stamp order, so that the first match
+      found is the same as when walking the whole suppressions list. */
+   for (c = 0; c < 3; c++) {
+      chain[c]   = NULL;
+      prev[c]    = NULL;
+   }
+   if (n_supp_indexed_fun > 0 || n_supp_indexed_obj > 0)
+      expandInput(&ip2fo, 0);
+   if (n_supp_indexed_fun > 0)
+      chain[0] = &supp_index[supp_name_hash
+                             (FunName, foComplete(&ip2fo, 0, True))];
+   if (n_supp_indexed_obj > 0)
+      chain[1] = &supp_index[supp_name_hash
+                             (ObjName, foComplete(&ip2fo, 0, False))];
+   chain[2] = &supp_wild;
+   if (chain[1] == chain[0])
+      chain[1] = NULL;
+   for (c = 0; c < 3; c++)
+      cur[c] = chain[c] == NULL ? NULL : *chain[c];
+
+   while (True) {
+      /* Next candidate: the one with the highest stamp. */
+      Int best = -1;
+      for (c = 0; c < 3; c++)
+         if (cur[c] != NULL
+             && (best == -1 || cur[c]->stamp > cur[best]->stamp))
+            best = c;
+      if (best == -1)
+         break;
+      su = cur[best];
+
       em_supplist_cmps++;
       if (supp_matches_error(su, err) 
           && supp_matches_callers(&ip2fo, su)) {
          /* got a match.  */
          /* Inform the tool that err is suppressed by su. */
          (void)VG_TDICT_CALL(tool_update_extra_suppression_use, err, su);
-         /* Move this entry to the head of the list
+         /* Move this entry to the head of the list and of its chain
             in the hope of making future searches cheaper. */
-         if (su_prev) {
-            vg_assert(su_prev->next == su);
-            su_prev->next = su->next;
+         if (su->prev != NULL) {
+            vg_assert(su->prev->next == su);
+            su->prev->next = su->next;
+            if (su->next != NULL)
+               su->next->prev = su->prev;
+            su->prev = NULL;
             su->next = suppressions;
+            suppressions->prev = su;
             suppressions = su;
+            su->stamp = ++supp_stamp;
+         }
+         if (prev[best] != NULL) {
+            vg_assert(prev[best]->index_next == su);
+            prev[best]->index_next = su->index_next;
+            su->index_next = *chain[best];
+            *chain[best] = su;
          }
          clearIPtoFunOrObjCompleter(su, &ip2fo);
          return su;
       }
-      su_prev = su;
+      prev[best] = su;
+      cur[best]  = su->index_next;
    }
    clearIPtoFunOrObjCompleter(NULL, &ip2fo);
    return NULL;      /* no matches */
@@ -2034,6 +2324,10 @@ void VG_(print_errormgr_stats) ( void )
       " errormgr: %'lu errlist searches, %'lu comparisons during search\n",
       em_errlist_searches, em_errlist_cmps
    );
+   VG_(dmsg)(
+      " errormgr: %'lu errors counted without searching the errlist\n",
+      em_errlist_ip_hits
+   );
 }
 
 /*--------------------------------------------------------------------*/
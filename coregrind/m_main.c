@@ -126,6 +126,8 @@ static void usage_NORETURN ( int need_help )
 "    --num-callers=<number>    show <number> callers in stack traces [12]\n"
 "    --error-limit=no|yes      stop showing new errors if too many? [yes]\n"
 "    --exit-on-first-error=no|yes exit code on the first error found? [no]\n"
+"    --fast-error-counting=no|yes count errors repeated by the same code\n"
+"                              without computing their stack trace? [no]\n"
 "    --error-exitcode=<number> exit code to return if errors found [0=disable]\n"
 "    --error-markers=<begin>,<end> add lines with begin/end markers before/after\n"
 "                              each error output in plain text mode [none]\n"
@@ -247,6 +249,8 @@ static void usage_NORETURN ( int need_help )
 "                                [0, meaning only at the end of the run]\n"
 "    --trace-notbelow=<number> only show BBs above <number> [999999999]\n"
 "    --trace-notabove=<number> only show BBs below <number> [0]\n"
+"    --perf-map=no|yes         write /tmp/perf-<pid>.map describing generated\n"
+"                              code, for use by 'perf report' [no]\n"
 "    --trace-syscalls=no|yes   show all system calls? [no]\n"
 "    --trace-signals=no|yes    show signal handling details? [no]\n"
 "    --trace-symtab=no|yes     show symbol table details? [no]\n"
@@ -270,6 +274,7 @@ static void usage_NORETURN ( int need_help )
 "    --vex-iropt-verbosity=<0..9>           [0]\n"
 "    --vex-iropt-level=<0..2>               [2]\n"
 "    --vex-iropt-unroll-thresh=<0..400>     [120]\n"
+"    --vex-iropt-cse-unrolled=no|yes        [no]\n"
 "    --vex-guest-max-insns=<1..100>         [50]\n"
 "    --vex-guest-chase=no|yes               [yes]\n"
 "    Precise exception control.  Possible values for 'mode' are as follows\n"
@@ -560,6 +565,8 @@ static void process_option (Clo_Mode mode,
    else if VG_STR_CLO (arg, "--soname-synonyms",VG_(clo_soname_synonyms)) {}
    else if VG_BOOL_CLO(arg, "--error-limit",    VG_(clo_error_limit)) {}
    else if VG_BOOL_CLO(arg, "--exit-on-first-error", VG_(clo_exit_on_first_error)) {}
+   else if VG_BOOL_CLO(arg, "--fast-error-counting",
+                       VG_(clo_fast_error_counting)) {}
    else if VG_INT_CLO (arg, "--error-exitcode", VG_(clo_error_exitcode)) {}
    else if VG_STR_CLOM (cloPD, arg, "--error-markers",  tmp_str) {
       Int m;
@@ -629,6 +636,7 @@ static void process_option (Clo_Mode mode,
    else if VG_XACT_CLOM(cloPD, arg, "--debug-dump=frames",
                         VG_(clo_debug_dump_frames), True) {}
    else if VG_BOOL_CLOM(cloPD, arg, "--trace-redir",      VG_(clo_trace_redir)) {}
+   else if VG_BOOL_CLO(arg, "--perf-map",          VG_(clo_perf_map)) {}
 
    else if VG_BOOL_CLOM(cloPD, arg, "--trace-syscalls",   VG_(clo_trace_syscalls)) {}
    else if VG_BOOL_CLOM(cloE, arg, "--wait-for-gdb",     VG_(clo_wait_for_gdb)) { 
@@ -720,6 +728,8 @@ static void process_option (Clo_Mode mode,
 
    else if VG_BINT_CLO(arg, "--vex-iropt-unroll-thresh",
                        VG_(clo_vex_control).iropt_unroll_thresh, 0, 400) {}
+   else if VG_BOOL_CLO(arg, "--vex-iropt-cse-unrolled",
+                       VG_(clo_vex_control).iropt_cse_unrolled) {}
    else if VG_BINT_CLO(arg, "--vex-guest-max-insns",
                        VG_(clo_vex_control).guest_max_insns, 1, 100) {}
    else if VG_BOOL_CLO(arg, "--vex-guest-chase",
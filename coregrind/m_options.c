@@ -92,6 +92,7 @@ Bool   VG_(clo_error_limit)    = True;
 Int    VG_(clo_error_exitcode) = 0;
 HChar *VG_(clo_error_markers)[2] = {NULL, NULL};
 Bool   VG_(clo_exit_on_first_error) = False;
+Bool   VG_(clo_fast_error_counting) = False;
 
 Bool   VG_(clo_show_error_list) = False;
 
@@ -134,6 +135,7 @@ const HChar* VG_(clo_extra_debuginfo_path) = NULL;
 const HChar* VG_(clo_debuginfo_server) = NULL;
 Bool   VG_(clo_allow_mismatched_debuginfo) = False;
 UChar  VG_(clo_trace_flags)    = 0; // 00000000b
+Bool   VG_(clo_perf_map)       = False;
 Bool   VG_(clo_profyle_sbs)    = False;
 UChar  VG_(clo_profyle_flags)  = 0; // 00000000b
 ULong  VG_(clo_profyle_interval) = 0;
@@ -34,6 +34,7 @@
 #include "pub_core_vki.h"        // to keep pub_core_libproc.h happy, sigh
 #include "pub_core_libcproc.h"   // VG_(invalidate_icache)
 #include "pub_core_libcassert.h"
+#include "pub_core_libcfile.h"   // VG_(open), VG_(safe_fd), for --perf-map
 #include "pub_core_libcprint.h"
 #include "pub_core_options.h"
 #include "pub_core_tooliface.h"  // For VG_(details).avg_translation_sizeB
@@ -42,6 +43,7 @@
 #include "pub_core_mallocfree.h" // VG_(out_of_memory_NORETURN)
 #include "pub_core_xarray.h"
 #include "pub_core_dispatch.h"   // For VG_(disp_cp*) addresses
+#include "pub_core_debuginfo.h"  // VG_(get_fnname_w_offset), for --perf-map
 
 
 #define DEBUG_TRANSTAB 0
@@ -1723,6 +1725,83 @@ static void initialiseSector ( SECno sno )
    }
 }
 
+/*-------------------------------------------------------------*/
+/*--- Perf map output (--perf-map=yes)                      ---*/
+/*-------------------------------------------------------------*/
+
+/* When --perf-map=yes is given, each translation copied into the
+   translation cache is described by one line "START SIZE NAME" (START
+   and SIZE in hex) in /tmp/perf-<pid>.map, which is the format 'perf
+   report' uses to symbolise samples falling in JIT-generated code.
+   NAME is the guest function (and offset) of the translation's entry
+   point, so the host profile shows which guest code -- together with
+   the instrumentation the tool added to it -- the time went into.
+
+   The perf map format has no way to retract an entry, so translations
+   removed by VG_(discard_translations) are not withdrawn.  Their host
+   code is not reused until the containing sector is recycled, at which
+   point the new translations occupying that space are appended. */
+
+static Int perf_map_fd  = -1;
+static Int perf_map_pid = -1;
+
+static void perf_map_open ( void )
+{
+   HChar  fname[64];
+   SysRes sres;
+
+   /* After a fork, the inherited fd describes the parent's map. */
+   if (perf_map_fd >= 0)
+      VG_(close)(perf_map_fd);
+   perf_map_fd  = -1;
+   perf_map_pid = VG_(getpid)();
+
+   VG_(sprintf)(fname, "/tmp/perf-%d.map", perf_map_pid);
+   sres = VG_(open)(fname, VKI_O_CREAT|VKI_O_TRUNC|VKI_O_WRONLY,
+                    VKI_S_IRUSR|VKI_S_IWUSR|VKI_S_IRGRP|VKI_S_IROTH);
+   if (sr_isError(sres)) {
+      VG_(umsg)("Warning: cannot create perf map file %s; "
+                "--perf-map=yes ignored\n", fname);
+      VG_(clo_perf_map) = False;
+      return;
+   }
+   perf_map_fd = VG_(safe_fd)(sr_Res(sres));
+}
+
+static void perf_map_note_translation ( Addr entry, const UChar* hcode,
+                                        UInt hcode_len,
+                                        Bool is_self_checking,
+                                        Bool is_unredir )
+{
+   const HChar* name;
+   const HChar* tag;
+   HChar        line[512];
+   UInt         n;
+   DiEpoch      ep = VG_(current_DiEpoch)();
+
+   if (perf_map_pid != VG_(getpid)())
+      perf_map_open();
+   if (perf_map_fd < 0)
+      return;
+
+   tag = is_unredir ? " [noredir]" : is_self_checking ? " [sc]" : "";
+   if (VG_(get_fnname_w_offset)(ep, entry, &name))
+      n = VG_(snprintf)(line, sizeof(line), "%lx %x %s%s\n",
+                        (Addr)hcode, hcode_len, name, tag);
+   else if (VG_(get_objname)(ep, entry, &name))
+      n = VG_(snprintf)(line, sizeof(line), "%lx %x %s:0x%lx%s\n",
+                        (Addr)hcode, hcode_len, name, entry, tag);
+   else
+      n = VG_(snprintf)(line, sizeof(line), "%lx %x 0x%lx%s\n",
+                        (Addr)hcode, hcode_len, entry, tag);
+
+   /* An overlong (C++) name was truncated: keep the line terminated. */
+   if (n >= sizeof(line) - 1)
+      line[n - 1] = '\n';
+   VG_(write)(perf_map_fd, line, n);
+}
+
+
 /* Add a translation of vge to TT/TC.  The translation is temporarily
    in code[0 .. code_len-1].
 
@@ -1875,6 +1954,10 @@ void VG_(add_to_transtab)( const VexGuestExtents* vge,
 
    VG_(invalidate_icache)( dstP, code_len );
 
+   if (VG_(clo_perf_map))
+      perf_map_note_translation( entry, dstP, code_len,
+                                 is_self_checking, False );
+
    /* Add this entry to the host_extents map, checking that we're
       adding in order. */
    { HostExtent hx;
@@ -2447,6 +2530,10 @@ void VG_(add_to_unredir_transtab)( const VexGuestExtents* vge,
 
    VG_(invalidate_icache)( dstP, code_len );
 
+   if (VG_(clo_perf_map))
+      perf_map_note_translation( entry, (UChar*)dstP, code_len,
+                                 False, True );
+
    unredir_tt[i].inUse = True;
    unredir_tt[i].vge   = *vge;
    unredir_tt[i].hcode = (Addr)dstP;
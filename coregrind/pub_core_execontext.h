@@ -51,13 +51,6 @@ extern void VG_(print_ExeContext_stats) ( Bool with_stacktraces );
 extern void VG_(archive_ExeContext_in_range) (DiEpoch last_epoch,
                                               Addr text_avma, SizeT length );
 
-// Extract the StackTrace from an ExeContext.
-// (Minor hack: we use Addr* as the return type instead of StackTrace so
-// that modules #including this file don't also have to #include
-// pub_core_stacktrace.h also.)
-extern
-/*StackTrace*/Addr* VG_(get_ExeContext_StackTrace) ( ExeContext* e );
-
 
 #endif   // __PUB_CORE_EXECONTEXT_H
 
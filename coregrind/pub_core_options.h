@@ -44,6 +44,9 @@ extern const HChar *VG_(clo_toolname);
 extern Bool  VG_(clo_error_limit);
 /* Should we exit if an error appears?  default: NO */
 extern Bool  VG_(clo_exit_on_first_error);
+/* Should errors repeatedly reported by the same code be counted without
+   computing their stack trace?  default: NO */
+extern Bool  VG_(clo_fast_error_counting);
 /* Alternative exit code to hand to parent if errors were found.
    default: 0 (no, return the application's exit code in the normal
    way. */
@@ -164,6 +167,12 @@ extern Bool VG_(clo_allow_mismatched_debuginfo);
 /* DEBUG: print generated code?  default: 00000000 ( == NO ) */
 extern UChar VG_(clo_trace_flags);
 
+/* DEBUG: write a perf map (/tmp/perf-<pid>.map) describing each
+   translation added to the translation cache, so that host tools such
+   as 'perf report' can attribute samples taken inside generated code.
+   default: False (== NO) */
+extern Bool  VG_(clo_perf_map);
+
 /* DEBUG: do SB profiling? default: False (== NO).  NOTE: does not
    have an associated command line flag.  Is set to True whenever
    --profile-flags= is specified. */
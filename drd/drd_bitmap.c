@@ -181,6 +181,7 @@ void DRD_(bm_access_range_load)(struct bitmap* const bm, Addr a1, Addr a2)
       {
          unsigned k;
 
+         bm2->used = ~(UWord)0;
          for (k = 0; k < BITMAP1_UWORD_COUNT; k++)
          {
             bm2->bm1.bm0_r[k] = ~(UWord)0;
@@ -188,10 +189,9 @@ void DRD_(bm_access_range_load)(struct bitmap* const bm, Addr a1, Addr a2)
       }
       else
       {
-         for (b0 = address_lsb(b_start); b0 <= address_lsb(b_end - 1); b0++)
-         {
-            bm0_set(bm2->bm1.bm0_r, b0);
-         }
+         b0 = address_lsb(b_start);
+         bm2->used |= bm2_used_mask(b0, address_lsb(b_end - 1) + 1);
+         bm0_set_span(bm2->bm1.bm0_r, b0, address_lsb(b_end - 1) + 1);
       }
    }
 }
@@ -278,6 +278,7 @@ void DRD_(bm_access_range_store)(struct bitmap* const bm,
       {
          unsigned k;
 
+         bm2->used = ~(UWord)0;
          for (k = 0; k < BITMAP1_UWORD_COUNT; k++)
          {
             bm2->bm1.bm0_w[k] = ~(UWord)0;
@@ -285,10 +286,9 @@ void DRD_(bm_access_range_store)(struct bitmap* const bm,
       }
       else
       {
-         for (b0 = address_lsb(b_start); b0 <= address_lsb(b_end - 1); b0++)
-         {
-            bm0_set(bm2->bm1.bm0_w, b0);
-         }
+         b0 = address_lsb(b_start);
+         bm2->used |= bm2_used_mask(b0, address_lsb(b_end - 1) + 1);
+         bm0_set_span(bm2->bm1.bm0_w, b0, address_lsb(b_end - 1) + 1);
       }
    }
 }
@@ -346,17 +346,9 @@ Bool DRD_(bm_has_any_load_g)(struct bitmap* const bm)
 
    VG_(OSetGen_ResetIter)(bm->oset);
    for ( ; (bm2 = VG_(OSetGen_Next)(bm->oset)) != NULL; ) {
-      Addr b_start;
-      Addr b_end;
-      UWord b0;
-      const struct bitmap1* const p1 = &bm2->bm1;
-
-      b_start = make_address(bm2->addr, 0);
-      b_end = make_address(bm2->addr + 1, 0);
-
-      for (b0 = address_lsb(b_start); b0 <= address_lsb(b_end - 1); b0++)
-         if (bm0_is_set(p1->bm0_r, b0))
-            return True;
+      if (bm2->used
+          && bm0_is_any_set_span(bm2->bm1.bm0_r, 0, 1U << ADDR_LSB_BITS))
+         return True;
    }
    return False;
 }
@@ -402,12 +394,12 @@ DRD_(bm_has_any_load)(struct bitmap* const bm, const Addr a1, const Addr a2)
          tl_assert(b_start < b_end);
          tl_assert(address_lsb(b_start) <= address_lsb(b_end - 1));
 
-         for (b0 = address_lsb(b_start); b0 <= address_lsb(b_end - 1); b0++)
+         b0 = address_lsb(b_start);
+         if (bm2->used
+             && bm0_is_any_set_span(p1->bm0_r, b0,
+                                    address_lsb(b_end - 1) + 1))
          {
-            if (bm0_is_set(p1->bm0_r, b0))
-            {
-               return True;
-            }
+            return True;
          }
       }
    }
@@ -455,12 +447,12 @@ Bool DRD_(bm_has_any_store)(struct bitmap* const bm,
          tl_assert(b_start < b_end);
          tl_assert(address_lsb(b_start) <= address_lsb(b_end - 1));
 
-         for (b0 = address_lsb(b_start); b0 <= address_lsb(b_end - 1); b0++)
+         b0 = address_lsb(b_start);
+         if (bm2->used
+             && bm0_is_any_set_span(p1->bm0_w, b0,
+                                    address_lsb(b_end - 1) + 1))
          {
-            if (bm0_is_set(p1->bm0_w, b0))
-            {
-               return True;
-            }
+            return True;
          }
       }
    }
@@ -510,16 +502,14 @@ Bool DRD_(bm_has_any_access)(struct bitmap* const bm,
          tl_assert(b_start < b_end);
          tl_assert(address_lsb(b_start) <= address_lsb(b_end - 1));
 
-         for (b0 = address_lsb(b_start); b0 <= address_lsb(b_end - 1); b0++)
+         b0 = address_lsb(b_start);
+         if (bm2->used
+             && (bm0_is_any_set_span(p1->bm0_r, b0,
+                                     address_lsb(b_end - 1) + 1)
+                 || bm0_is_any_set_span(p1->bm0_w, b0,
+                                        address_lsb(b_end - 1) + 1)))
          {
-            /*
-             * Note: the statement below uses a binary or instead of a logical
-             * or on purpose.
-             */
-            if (bm0_is_set(p1->bm0_r, b0) | bm0_is_set(p1->bm0_w, b0))
-            {
-               return True;
-            }
+            return True;
          }
       }
    }
@@ -1166,7 +1156,8 @@ int DRD_(bm_has_races)(struct bitmap* const lhs, struct bitmap* const rhs)
       const struct bitmap2* bm2r;
       const struct bitmap1* bm1l;
       const struct bitmap1* bm1r;
-      unsigned k;
+      UWord used;
+      unsigned i;
 
       bm2l = VG_(OSetGen_Next)(lhs->oset);
       bm2r = VG_(OSetGen_Next)(rhs->oset);
@@ -1183,20 +1174,31 @@ int DRD_(bm_has_races)(struct bitmap* const lhs, struct bitmap* const rhs)
       bm1l = &bm2l->bm1;
       bm1r = &bm2r->bm1;
 
-      for (k = 0; k < BITMAP1_UWORD_COUNT; k++)
+      /* Only look at the words that have been accessed in both bitmaps. */
+      used = bm2l->used & bm2r->used;
+      for (i = 0; i < BITS_PER_UWORD && used >> i; i++)
       {
-         unsigned b;
-         for (b = 0; b < BITS_PER_UWORD; b++)
+         unsigned k;
+
+         if (!(used & ((UWord)1 << i)))
+            continue;
+         for (k = i << BITMAP1_USED_SHIFT;
+              k < (i + 1) << BITMAP1_USED_SHIFT;
+              k++)
          {
-            UWord const access_mask
-               = ((bm1l->bm0_r[k] & bm0_mask(b)) ? LHS_R : 0)
-               | ((bm1l->bm0_w[k] & bm0_mask(b)) ? LHS_W : 0)
-               | ((bm1r->bm0_r[k] & bm0_mask(b)) ? RHS_R : 0)
-               | ((bm1r->bm0_w[k] & bm0_mask(b)) ? RHS_W : 0);
-            Addr const a = make_address(bm2l->addr, k * BITS_PER_UWORD | b);
-            if (HAS_RACE(access_mask) && ! DRD_(is_suppressed)(a, a + 1))
+            /* The bits of HAS_RACE(), for all addresses of bm0[k] at once. */
+            const UWord races
+               = (bm1r->bm0_w[k] & (bm1l->bm0_r[k] | bm1l->bm0_w[k]))
+               | (bm1l->bm0_w[k] & (bm1r->bm0_r[k] | bm1r->bm0_w[k]));
+            unsigned b;
+
+            for (b = 0; b < BITS_PER_UWORD && races >> b; b++)
             {
-               return 1;
+               Addr const a = make_address(bm2l->addr, k * BITS_PER_UWORD | b);
+               if ((races & bm0_mask(b)) && ! DRD_(is_suppressed)(a, a + 1))
+               {
+                  return 1;
+               }
             }
          }
       }
@@ -1267,12 +1269,36 @@ void bm2_merge(struct bitmap2* const bm2l, const struct bitmap2* const bm2r)
 
    s_bitmap2_merge_count++;
 
-   for (k = 0; k < BITMAP1_UWORD_COUNT; k++)
+   bm2l->used |= bm2r->used;
+
+   if (bm2r->used == ~(UWord)0)
    {
-      bm2l->bm1.bm0_r[k] |= bm2r->bm1.bm0_r[k];
+      /* Dense case: straight loops the compiler can vectorize. */
+      for (k = 0; k < BITMAP1_UWORD_COUNT; k++)
+      {
+         bm2l->bm1.bm0_r[k] |= bm2r->bm1.bm0_r[k];
+      }
+      for (k = 0; k < BITMAP1_UWORD_COUNT; k++)
+      {
+         bm2l->bm1.bm0_w[k] |= bm2r->bm1.bm0_w[k];
+      }
    }
-   for (k = 0; k < BITMAP1_UWORD_COUNT; k++)
+   else
    {
-      bm2l->bm1.bm0_w[k] |= bm2r->bm1.bm0_w[k];
+      /* Sparse case: skip the words of *bm2r that have not been accessed. */
+      unsigned i;
+
+      for (i = 0; i < BITS_PER_UWORD && bm2r->used >> i; i++)
+      {
+         if (!(bm2r->used & ((UWord)1 << i)))
+            continue;
+         for (k = i << BITMAP1_USED_SHIFT;
+              k < (i + 1) << BITMAP1_USED_SHIFT;
+              k++)
+         {
+            bm2l->bm1.bm0_r[k] |= bm2r->bm1.bm0_r[k];
+            bm2l->bm1.bm0_w[k] |= bm2r->bm1.bm0_w[k];
+         }
+      }
    }
 }
@@ -149,6 +149,12 @@ Addr make_address(const UWord a1, const UWord a0)
 /** Number of UWord's needed to store one bit per address LSB. */
 #define BITMAP1_UWORD_COUNT (1U << (ADDR_LSB_BITS - BITS_PER_BITS_PER_UWORD))
 
+/**
+ * Log2 of the number of bm0[] elements summarized by one bit of
+ * bitmap2::used, such that bitmap2::used fits in a single UWord.
+ */
+#define BITMAP1_USED_SHIFT (ADDR_LSB_BITS - 2 * BITS_PER_BITS_PER_UWORD)
+
 /**
  * Mask that has to be applied to an (Addr >> ADDR_IGNORED_BITS) expression
  * in order to compute the least significant part of an UWord.
@@ -322,6 +328,62 @@ static __inline__ UWord bm0_is_any_set(const UWord* bm0,
    return (bm0[uword_msb(a)] & ((((UWord)1 << size) - 1) << uword_lsb(a)));
 }
 
+/**
+ * Return the bits of bm0[k] that correspond to the addresses in range
+ * [ a1 << ADDR_IGNORED_BITS .. a2 << ADDR_IGNORED_BITS [, with
+ * uword_msb(a1) <= k <= uword_msb(a2 - 1).
+ */
+static __inline__ UWord bm0_span_mask(const UWord k,
+                                      const UWord a1, const UWord a2)
+{
+   UWord mask = ~(UWord)0;
+
+#ifdef ENABLE_DRD_CONSISTENCY_CHECKS
+   tl_assert(a1 < a2);
+   tl_assert(uword_msb(a1) <= k && k <= uword_msb(a2 - 1));
+#endif
+   if (k == uword_msb(a1))
+      mask <<= uword_lsb(a1);
+   if (k == uword_msb(a2 - 1))
+      mask &= ~(UWord)0 >> (BITS_PER_UWORD - 1 - uword_lsb(a2 - 1));
+   return mask;
+}
+
+/**
+ * Set the bits corresponding to all of the addresses in range
+ * [ a1 << ADDR_IGNORED_BITS .. a2 << ADDR_IGNORED_BITS [ in bitmap bm0.
+ * Unlike bm0_set_range(), the range may span several bm0[] elements.
+ */
+static __inline__ void bm0_set_span(UWord* bm0, const UWord a1, const UWord a2)
+{
+   UWord k;
+
+#ifdef ENABLE_DRD_CONSISTENCY_CHECKS
+   tl_assert(a1 < a2 && a2 <= (1U << ADDR_LSB_BITS));
+#endif
+   for (k = uword_msb(a1); k <= uword_msb(a2 - 1); k++)
+      bm0[k] |= bm0_span_mask(k, a1, a2);
+}
+
+/**
+ * Return true if a bit corresponding to any of the addresses in range
+ * [ a1 << ADDR_IGNORED_BITS .. a2 << ADDR_IGNORED_BITS [ is set in bm0.
+ * Unlike bm0_is_any_set(), the range may span several bm0[] elements.
+ */
+static __inline__ UWord bm0_is_any_set_span(const UWord* bm0,
+                                            const UWord a1, const UWord a2)
+{
+   UWord k;
+
+#ifdef ENABLE_DRD_CONSISTENCY_CHECKS
+   tl_assert(a1 < a2 && a2 <= (1U << ADDR_LSB_BITS));
+#endif
+   for (k = uword_msb(a1); k <= uword_msb(a2 - 1); k++)
+      if (bm0[k] & bm0_span_mask(k, a1, a2))
+         return True;
+   return False;
+}
+
 
 
 /*********************************************************************/
@@ -334,9 +396,34 @@ struct bitmap2
 {
    Addr           addr;   ///< address_msb(...)
    Bool           recalc;
+   /**
+    * Bit i is set if an access may have been recorded in the bm0[] elements
+    * [ i << BITMAP1_USED_SHIFT .. (i + 1) << BITMAP1_USED_SHIFT [ of bm1.
+    * Clearing accesses leaves this field unchanged. Zero means that bm1 is
+    * empty.
+    */
+   UWord          used;
    struct bitmap1 bm1;
 };
 
+/** Return the bit of bitmap2::used that corresponds to bm0[uword_msb(a)]. */
+static __inline__ UWord bm2_used_bit(const UWord a)
+{
+   return (UWord)1 << (uword_msb(a) >> BITMAP1_USED_SHIFT);
+}
+
+/**
+ * Return the bits of bitmap2::used that correspond to the bm0[] elements
+ * uword_msb(a1) .. uword_msb(a2 - 1).
+ */
+static __inline__ UWord bm2_used_mask(const UWord a1, const UWord a2)
+{
+   const UWord first = uword_msb(a1) >> BITMAP1_USED_SHIFT;
+   const UWord last = uword_msb(a2 - 1) >> BITMAP1_USED_SHIFT;
+
+   return (~(UWord)0 >> (BITS_PER_UWORD - 1 - last)) & (~(UWord)0 << first);
+}
+
 
 static void bm2_clear(struct bitmap2* const bm2);
 static __inline__
@@ -547,6 +634,7 @@ void bm2_clear(struct bitmap2* const bm2)
 #ifdef ENABLE_DRD_CONSISTENCY_CHECKS
    tl_assert(bm2);
 #endif
+   bm2->used = 0;
    VG_(memset)(&bm2->bm1, 0, sizeof(bm2->bm1));
 }
 
@@ -585,6 +673,7 @@ struct bitmap2* bm2_insert_copy(struct bitmap* const bm,
    struct bitmap2* bm2_copy;
 
    bm2_copy = bm2_insert(bm, bm2->addr);
+   bm2_copy->used = bm2->used;
    VG_(memcpy)(&bm2_copy->bm1, &bm2->bm1, sizeof(bm2->bm1));
    return bm2_copy;
 }
@@ -666,6 +755,7 @@ void bm_access_aligned_load(struct bitmap* const bm,
 #endif
 
    bm2 = bm2_lookup_or_insert_exclusive(bm, address_msb(a1));
+   bm2->used |= bm2_used_bit(address_lsb(a1));
    bm0_set_range(bm2->bm1.bm0_r,
                  (a1 >> ADDR_IGNORED_BITS) & ADDR_LSB_MASK,
                  SCALED_SIZE(size));
@@ -682,6 +772,7 @@ void bm_access_aligned_store(struct bitmap* const bm,
 #endif
 
    bm2 = bm2_lookup_or_insert_exclusive(bm, address_msb(a1));
+   bm2->used |= bm2_used_bit(address_lsb(a1));
    bm0_set_range(bm2->bm1.bm0_w,
                  (a1 >> ADDR_IGNORED_BITS) & ADDR_LSB_MASK,
                  SCALED_SIZE(size));
@@ -163,8 +163,19 @@ static void drd_report_race(const Addr addr, const SizeT size,
          .size = size,
          .access_type = access_type,
       };
-      VG_(maybe_record_error)(vg_tid, DataRaceErr, VG_(get_IP)(vg_tid),
-                              "Conflicting access", &drei);
+      if (size < 128) {
+         /* With --fast-error-counting=yes, conflicting accesses from the
+            same code to the same eight bytes are counted without
+            computing a stack trace. The low bits hold everything
+            drd_compare_error_contexts() compares. */
+         const UWord key = ((addr >> 3) << 8) | (size << 1) | access_type;
+         VG_(maybe_record_error_at_ip)(vg_tid, DataRaceErr,
+                                       VG_(get_IP)(vg_tid),
+                                       "Conflicting access", &drei, key);
+      } else {
+         VG_(maybe_record_error)(vg_tid, DataRaceErr, VG_(get_IP)(vg_tid),
+                                 "Conflicting access", &drei);
+      }
 
       if (s_first_race_only)
          DRD_(start_suppression)(addr, addr + size, "first race only");
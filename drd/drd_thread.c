@@ -47,6 +47,8 @@ static void thread_append_segment(const DrdThreadId tid, Segment* const sg);
 static void thread_discard_segment(const DrdThreadId tid, Segment* const sg);
 static void thread_compute_conflict_set(struct bitmap** conflict_set,
                                         const DrdThreadId tid);
+static void thread_switch_conflict_set(const DrdThreadId old_tid,
+                                       const DrdThreadId new_tid);
 static Bool thread_conflict_set_up_to_date(const DrdThreadId tid);
 
 
@@ -55,6 +57,7 @@ static Bool thread_conflict_set_up_to_date(const DrdThreadId tid);
 static ULong    s_context_switch_count;
 static ULong    s_discard_ordered_segments_count;
 static ULong    s_compute_conflict_set_count;
+static ULong    s_switch_conflict_set_count;
 static ULong    s_update_conflict_set_count;
 static ULong    s_update_conflict_set_new_sg_count;
 static ULong    s_update_conflict_set_sync_count;
@@ -64,7 +67,13 @@ static ULong    s_conflict_set_bitmap2_creation_count;
 static ThreadId s_vg_running_tid  = VG_INVALID_THREADID;
 DrdThreadId     DRD_(g_drd_running_tid) = DRD_INVALID_THREADID;
 ThreadInfo*     DRD_(g_threadinfo);
+DrdThreadId     DRD_(g_threadinfo_end) = 1;
 struct bitmap*  DRD_(g_conflict_set);
+/*
+ * Thread for which DRD_(g_conflict_set) is up to date, or
+ * DRD_INVALID_THREADID if the conflict set has to be recomputed from scratch.
+ */
+static DrdThreadId s_conflict_set_tid = DRD_INVALID_THREADID;
 Bool DRD_(verify_conflict_set);
 static Bool     s_trace_context_switches = False;
 static Bool     s_trace_conflict_set = False;
@@ -207,6 +216,8 @@ static DrdThreadId DRD_(VgThreadIdToNewDrdThreadId)(const ThreadId tid)
          DRD_(g_threadinfo)[i].synchr_nesting = 0;
          DRD_(g_threadinfo)[i].deletion_seq = s_deletion_tail - 1;
          DRD_(g_threadinfo)[i].creator_thread = DRD_INVALID_THREADID;
+         if (i >= DRD_(g_threadinfo_end))
+            DRD_(g_threadinfo_end) = i + 1;
 #if defined (VGO_solaris)
          DRD_(g_threadinfo)[i].bind_guard_flag = 0;
 #endif /* VGO_solaris */
@@ -533,6 +544,7 @@ void DRD_(thread_delete)(const DrdThreadId tid, const Bool detached)
       tl_assert(!DRD_(g_threadinfo)[tid].detached_posix_thread);
    DRD_(g_threadinfo)[tid].sg_first = NULL;
    DRD_(g_threadinfo)[tid].sg_last = NULL;
+   s_conflict_set_tid = DRD_INVALID_THREADID;
 
    tl_assert(!DRD_(IsValidDrdThreadId)(tid));
 }
@@ -583,6 +595,7 @@ void DRD_(drd_thread_atfork_child)(const ThreadId tid)
 
    DRD_(bm_cleanup)(DRD_(g_conflict_set));
    DRD_(bm_init)(DRD_(g_conflict_set));
+   s_conflict_set_tid = DRD_INVALID_THREADID;
 }
 
 /** Called just before pthread_cancel(). */
@@ -762,7 +775,8 @@ void DRD_(thread_set_vg_running_tid)(const ThreadId vg_tid)
 
 /**
  * Update s_vg_running_tid, DRD_(g_drd_running_tid) and recalculate the
- * conflict set.
+ * conflict set. The conflict set of the previously running thread is updated
+ * incrementally if it is still up to date, and recomputed otherwise.
  */
 void DRD_(thread_set_running_tid)(const ThreadId vg_tid,
                                   const DrdThreadId drd_tid)
@@ -783,7 +797,14 @@ void DRD_(thread_set_running_tid)(const ThreadId vg_tid,
       }
       s_vg_running_tid = vg_tid;
       DRD_(g_drd_running_tid) = drd_tid;
-      thread_compute_conflict_set(&DRD_(g_conflict_set), drd_tid);
+      if (s_conflict_set_tid != DRD_INVALID_THREADID
+          && s_conflict_set_tid != drd_tid
+          && DRD_(IsValidDrdThreadId)(s_conflict_set_tid)) {
+         thread_switch_conflict_set(s_conflict_set_tid, drd_tid);
+      } else {
+         thread_compute_conflict_set(&DRD_(g_conflict_set), drd_tid);
+      }
+      s_conflict_set_tid = drd_tid;
       s_context_switch_count++;
    }
 
@@ -1186,6 +1207,11 @@ void DRD_(thread_combine_vc_join)(DrdThreadId joiner, DrdThreadId joinee)
    } else {
       DRD_(vc_combine)(DRD_(thread_get_vc)(joiner),
                        DRD_(thread_get_vc)(joinee));
+      /*
+       * The conflict set has not been updated for the new vector clock of
+       * the joiner, hence it can't be updated incrementally anymore.
+       */
+      s_conflict_set_tid = DRD_INVALID_THREADID;
    }
 
    thread_discard_ordered_segments();
@@ -1542,6 +1568,114 @@ static void thread_compute_conflict_set(struct bitmap** conflict_set,
    }
 }
 
+/**
+ * Turn the conflict set of thread old_tid into the conflict set of thread
+ * new_tid after a context switch. Only the second-level bitmaps in which a
+ * segment that belongs to exactly one of these two conflict sets performed
+ * accesses are recomputed. When most threads run concurrently with both
+ * old_tid and new_tid, this is much cheaper than merging the bitmaps of all
+ * concurrent segments again.
+ */
+static void thread_switch_conflict_set(const DrdThreadId old_tid,
+                                       const DrdThreadId new_tid)
+{
+   const VectorClock* old_vc;
+   const VectorClock* new_vc;
+   unsigned j;
+   Bool changed = False;
+
+   tl_assert(old_tid != new_tid);
+   tl_assert(DRD_(IsValidDrdThreadId)(old_tid));
+   tl_assert(new_tid == DRD_(g_drd_running_tid));
+   tl_assert(DRD_(g_conflict_set));
+
+   if (s_trace_conflict_set) {
+      HChar* str;
+
+      str = DRD_(vc_aprint)(DRD_(thread_get_vc)(new_tid));
+      VG_(message)(Vg_DebugMsg,
+                   "switching conflict set from thread %u to thread %u"
+                   " with vc %s\n", old_tid, new_tid, str);
+      VG_(free)(str);
+   }
+
+   old_vc = DRD_(thread_get_vc)(old_tid);
+   new_vc = DRD_(thread_get_vc)(new_tid);
+
+   DRD_(bm_unmark)(DRD_(g_conflict_set));
+
+   for (j = 0; j < DRD_N_THREADS; j++) {
+      Segment* q;
+
+      if (!DRD_(IsValidDrdThreadId)(j))
+         continue;
+
+      /*
+       * A segment that precedes both old_vc and new_vc is in neither
+       * conflict set, and neither are the segments of thread j before it.
+       */
+      for (q = DRD_(g_threadinfo)[j].sg_last;
+           q && !(DRD_(vc_lte)(&q->vc, old_vc)
+                  && DRD_(vc_lte)(&q->vc, new_vc));
+           q = q->thr_prev) {
+         const Bool included_in_old_conflict_set
+            = j != old_tid
+            && !DRD_(vc_lte)(&q->vc, old_vc)
+            && !DRD_(vc_lte)(old_vc, &q->vc);
+         const Bool included_in_new_conflict_set
+            = j != new_tid
+            && !DRD_(vc_lte)(&q->vc, new_vc)
+            && !DRD_(vc_lte)(new_vc, &q->vc);
+
+         if (UNLIKELY(s_trace_conflict_set)) {
+            HChar* str;
+
+            str = DRD_(vc_aprint)(&q->vc);
+            VG_(message)(Vg_DebugMsg,
+                         "conflict set: [%u] %s segment %s\n", j,
+                         included_in_old_conflict_set
+                         != included_in_new_conflict_set
+                         ? "merging" : "ignoring", str);
+            VG_(free)(str);
+         }
+         if (included_in_old_conflict_set != included_in_new_conflict_set) {
+            DRD_(bm_mark)(DRD_(g_conflict_set), DRD_(sg_bm)(q));
+            changed = True;
+         }
+      }
+   }
+
+   if (changed) {
+      DRD_(bm_clear_marked)(DRD_(g_conflict_set));
+
+      for (j = 0; j < DRD_N_THREADS; j++) {
+         if (j != new_tid && DRD_(IsValidDrdThreadId)(j)) {
+            Segment* q;
+            for (q = DRD_(g_threadinfo)[j].sg_last;
+                 q && !DRD_(vc_lte)(&q->vc, new_vc);
+                 q = q->thr_prev) {
+               if (!DRD_(vc_lte)(new_vc, &q->vc))
+                  DRD_(bm_merge2_marked)(DRD_(g_conflict_set),
+                                         DRD_(sg_bm)(q));
+            }
+         }
+      }
+
+      DRD_(bm_remove_cleared_marked)(DRD_(g_conflict_set));
+   }
+
+   s_switch_conflict_set_count++;
+
+   if (s_trace_conflict_set_bm) {
+      VG_(message)(Vg_DebugMsg, "[%u] switched conflict set:\n", new_tid);
+      DRD_(bm_print)(DRD_(g_conflict_set));
+      VG_(message)(Vg_DebugMsg, "[%u] end of switched conflict set.\n",
+                   new_tid);
+   }
+
+   tl_assert(thread_conflict_set_up_to_date(new_tid));
+}
+
 /**
  * Update the conflict set after the vector clock of thread tid has been
  * updated from old_vc to its current value, either because a new segment has
@@ -1675,6 +1809,12 @@ ULong DRD_(thread_get_compute_conflict_set_count)()
    return s_compute_conflict_set_count;
 }
 
+/** Return how many times the conflict set has been switched incrementally. */
+ULong DRD_(thread_get_switch_conflict_set_count)(void)
+{
+   return s_switch_conflict_set_count;
+}
+
 /** Return how many times the conflict set has been updated partially. */
 ULong DRD_(thread_get_update_conflict_set_count)(void)
 {
@@ -121,6 +121,8 @@ typedef struct
 extern DrdThreadId    DRD_(g_drd_running_tid);
 /** Per-thread information managed by DRD. */
 extern ThreadInfo*    DRD_(g_threadinfo);
+/** One past the highest index of DRD_(g_threadinfo) ever used. */
+extern DrdThreadId    DRD_(g_threadinfo_end);
 /** Conflict set for the currently running thread. */
 extern struct bitmap* DRD_(g_conflict_set);
 extern Bool           DRD_(verify_conflict_set);
@@ -206,6 +208,7 @@ ULong DRD_(thread_get_context_switch_count)(void);
 ULong DRD_(thread_get_report_races_count)(void);
 ULong DRD_(thread_get_discard_ordered_segments_count)(void);
 ULong DRD_(thread_get_compute_conflict_set_count)(void);
+ULong DRD_(thread_get_switch_conflict_set_count)(void);
 ULong DRD_(thread_get_update_conflict_set_count)(void);
 ULong DRD_(thread_get_update_conflict_set_new_sg_count)(void);
 ULong DRD_(thread_get_update_conflict_set_sync_count)(void);
@@ -338,7 +341,7 @@ Bool DRD_(thread_address_on_any_stack)(const Addr a)
 {
    UInt i;
 
-   for (i = 1; i < DRD_N_THREADS; i++)
+   for (i = 1; i < DRD_(g_threadinfo_end); i++)
    {
       if (DRD_(g_threadinfo)[i].vg_thread_exists
           && DRD_(g_threadinfo)[i].stack_min <= a
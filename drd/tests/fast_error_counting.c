@@ -0,0 +1,64 @@
+/* Test --fast-error-counting=yes.  The same store in h() races when h()
+   is called from f() and from g().  The races from f() are suppressed by
+   fast_error_counting.supp.  Neither the races from g() nor those of the
+   second batch from f() may be counted in the context of the other
+   caller. */
+
+
+#include <pthread.h>
+#include <stdio.h>     /* printf() */
+#include <unistd.h>    /* sleep() */
+
+
+static void* thread_func(void*);
+
+
+/* Accessed simultaneously from both threads (race). */
+static volatile int s_x;
+
+
+static void __attribute__((noinline)) h(int i)
+{
+  s_x = i;
+}
+
+static void __attribute__((noinline)) f(int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    h(i);
+}
+
+static void __attribute__((noinline)) g(int n)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    h(i);
+}
+
+int main(int argc, char** argv)
+{
+  pthread_t threadid;
+
+  pthread_create(&threadid, 0, thread_func, 0);
+
+  sleep(1); /* Wait until thread_func() finished. */
+
+  f(1000);
+  g(1000);
+  f(1000);
+
+  pthread_join(threadid, 0);
+
+  printf("done\n");
+
+  return 0;
+}
+
+static void* thread_func(void* thread_arg)
+{
+  s_x = 1;
+  return 0;
+}
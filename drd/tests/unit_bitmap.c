@@ -59,7 +59,7 @@ UInt VG_(printf)(const HChar *format, ...)
 UInt VG_(message)(VgMsgKind kind, const HChar* format, ...)
 { UInt ret; va_list vargs; va_start(vargs, format); ret = vprintf(format, vargs); va_end(vargs); printf("\n"); return ret; }
 Bool DRD_(is_suppressed)(const Addr a1, const Addr a2)
-{ assert(0); }
+{ return False; }
 void VG_(vcbprintf)(void(*char_sink)(HChar, void* opaque),
                     void* opaque,
                     const HChar* format, va_list vargs)
@@ -192,6 +192,34 @@ void bm_test2()
   DRD_(bm_delete)(bm1);
 }
 
+/** Test whether bm_has_races() works correctly. */
+void bm_test4()
+{
+  const Addr a = make_address(1, 0);
+  struct bitmap* bm1;
+  struct bitmap* bm2;
+
+  bm1 = DRD_(bm_new)();
+  bm2 = DRD_(bm_new)();
+  DRD_(bm_access_load_1)(bm1, a + 100);
+  DRD_(bm_access_load_1)(bm2, a + 100);
+  assert(! DRD_(bm_has_races)(bm1, bm2));
+  DRD_(bm_access_store_1)(bm2, a + 101);
+  DRD_(bm_access_range_store)(bm1, a + 200, a + 300);
+  assert(! DRD_(bm_has_races)(bm1, bm2));
+  assert(! DRD_(bm_has_races)(bm2, bm1));
+  DRD_(bm_access_load_1)(bm2, a + 299);
+  assert(DRD_(bm_has_races)(bm1, bm2));
+  assert(DRD_(bm_has_races)(bm2, bm1));
+  DRD_(bm_clear)(bm2, a + 299, a + 300);
+  assert(! DRD_(bm_has_races)(bm1, bm2));
+  DRD_(bm_access_range_store)(bm2, make_address(2, 0), make_address(3, 0));
+  DRD_(bm_access_store_1)(bm1, make_address(3, 0) - 1);
+  assert(DRD_(bm_has_races)(bm1, bm2));
+  DRD_(bm_delete)(bm2);
+  DRD_(bm_delete)(bm1);
+}
+
 /** Torture test of the functions that set or clear a range of bits. */
 void bm_test3(const int outer_loop_step, const int inner_loop_step)
 {
@@ -351,6 +379,7 @@ int main(int argc, char** argv)
   DRD_(bm_module_init)();
   bm_test1();
   bm_test2();
+  bm_test4();
   bm_test3(outer_loop_step, inner_loop_step);
   DRD_(bm_module_cleanup)();
 
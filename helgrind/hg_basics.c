@@ -80,8 +80,12 @@ Bool  HG_(clo_delta_stacktrace) = True;
 Bool  HG_(clo_delta_stacktrace) = False;
 #endif
 
+Bool  HG_(clo_history_private) = True;
+
 UWord HG_(clo_conflict_cache_size) = 2000000;
 
+UWord HG_(clo_conflict_cache_mb) = 0;
+
 UWord HG_(clo_sanity_flags) = 0;
 
 Bool  HG_(clo_free_is_write) = False;
@@ -101,12 +101,28 @@ extern UWord HG_(clo_history_level);
       executed since the previous captured stacktrace. */
 extern Bool  HG_(clo_delta_stacktrace);
 
+/* When doing "full" history collection, whether to also record the
+   accesses to memory that only one thread has accessed so far.  If
+   no, the history of such memory is only recorded once a second
+   thread accesses it: this is much faster for programs working mostly
+   on thread-private memory, but a race on memory that was private
+   until then is reported without the stack trace of the previous
+   access.  Default is yes. */
+extern Bool  HG_(clo_history_private);
+
 /* When doing "full" history collection, this determines the size of
    the conflicting-access cache, measured in terms of maximum possible
    number of elements in the previous-access map.  Must be between 10k
    amd 10 million.  Default is 1 million. */
 extern UWord HG_(clo_conflict_cache_size);
 
+/* When doing "full" history collection, and if not 0, this is the
+   memory budget in MB of the conflicting-access cache, including the
+   stack traces it refers to.  It replaces HG_(clo_conflict_cache_size):
+   the maximum numbers of elements and of stack traces are then derived
+   from it.  0 or at least 4.  Default is 0. */
+extern UWord HG_(clo_conflict_cache_mb);
+
 /* Sanity check level.  This is an or-ing of
    SCE_{THREADS,LOCKS,BIGRANGE,ACCESS,LAOG}. */
 extern UWord HG_(clo_sanity_flags);
@@ -522,8 +522,17 @@ void HG_(record_error_Race) ( Thread* thr,
    xe.XE.Race.h1_ct_mbsegstartEC = h1_ct_segstart;
    xe.XE.Race.h1_ct_mbsegendEC   = h1_ct_mbsegendEC;
 
-   VG_(maybe_record_error)( thr->coretid,
-                            XE_Race, data_addr, NULL, &xe );
+   if (HG_(clo_cmp_race_err_addrs)) {
+      VG_(maybe_record_error)( thr->coretid,
+                               XE_Race, data_addr, NULL, &xe );
+   } else {
+      /* With --fast-error-counting=yes, races from the same code on
+         the same eight bytes are counted without computing a stack
+         trace.  The low bits hold everything HG_(eq_Error) compares. */
+      UWord key = ((data_addr >> 3) << 5) | (szB << 1) | (isWrite ? 1 : 0);
+      VG_(maybe_record_error_at_ip)( thr->coretid,
+                                     XE_Race, data_addr, NULL, &xe, key );
+   }
 }
 
 void HG_(record_error_UnlockUnlocked) ( Thread* thr, Lock* lk )
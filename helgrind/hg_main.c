@@ -618,7 +618,7 @@ static void initialise_data_structures ( Thr* hbthr_root )
 
    tl_assert(univ_lsets == NULL);
    univ_lsets = HG_(newWordSetU)( HG_(zalloc), "hg.ids.4", HG_(free),
-                                  8/*cacheSize*/ );
+                                  64/*cacheSize*/ );
    tl_assert(univ_lsets != NULL);
    /* Ensure that univ_lsets is non-empty, with lockset zero being the
       empty lockset.  hg_errors.c relies on the assumption that
@@ -629,7 +629,7 @@ static void initialise_data_structures ( Thr* hbthr_root )
    tl_assert(univ_laog == NULL);
    if (HG_(clo_track_lockorders)) {
       univ_laog = HG_(newWordSetU)( HG_(zalloc), "hg.ids.5 (univ_laog)",
-                                    HG_(free), 24/*cacheSize*/ );
+                                    HG_(free), 32/*cacheSize*/ );
       tl_assert(univ_laog != NULL);
    }
 
@@ -3505,8 +3505,7 @@ void evh__HG_RTLD_BIND_CLEAR(ThreadId tid, Int flags)
 /*--- Lock acquisition order monitoring                      ---*/
 /*--------------------------------------------------------------*/
 
-/* FIXME: here are some optimisations still to do in
-          laog__pre_thread_acquires_lock.
+/* Optimisations done in laog__pre_thread_acquires_lock.
 
    The graph is structured so that if L1 --*--> L2 then L1 must be
    acquired before L2.
@@ -3529,8 +3528,38 @@ void evh__HG_RTLD_BIND_CLEAR(ThreadId tid, Int flags)
    (2) Cache these add-edge requests and ignore them if said edges
        have already been added to laog.  Invalidate the cache any time
        any edges are deleted from laog.
+
+   Both are done by laog_cache, a direct-mapped cache indexed by
+   (Ln, {L1,L2,L3}).  Each entry records the value of laog_gen at the
+   time it was made, and laog_gen is incremented each time an edge is
+   added to or deleted from laog.  Adding the edges {L1,L2,L3} --> Ln
+   themselves does not change the answer of the query (1) for
+   (Ln, {L1,L2,L3}), so the entry stays valid after these are added.
 */
 
+typedef
+   struct {
+      Lock*     lk;      /* lock being acquired, NULL if unused */
+      WordSetID lockset; /* in univ_lsets: locks already held */
+      ULong     gen;     /* value of laog_gen when the entry was made */
+      Lock*     other;   /* result of laog__do_dfs_from_to */
+      Bool      edges_present; /* all lockset --> lk edges are in laog */
+   }
+   LAOGCacheEnt;
+
+#define N_LAOG_CACHE 1024 /* power of 2 */
+static LAOGCacheEnt laog_cache[N_LAOG_CACHE];
+static ULong laog_gen = 1;
+
+static UWord stats__laog_cache_queries = 0;
+static UWord stats__laog_cache_misses  = 0;
+
+static inline LAOGCacheEnt* laog_cache_ent ( Lock* lk, WordSetID lockset )
+{
+   UWord ix = ((UWord)lk >> 4) ^ ((UWord)lockset * 0x9E3779B1UL);
+   return &laog_cache[(ix ^ (ix >> 10)) & (N_LAOG_CACHE - 1)];
+}
+
 typedef
    struct {
       WordSetID inns; /* in univ_laog */
@@ -3735,6 +3764,9 @@ static void laog__add_edge ( Lock* src, Lock* dst ) {
 
    tl_assert( (presentF && presentR) || (!presentF && !presentR) );
 
+   if (!presentF)
+      laog_gen++;
+
    if (!presentF && src->acquired_at && dst->acquired_at) {
       LAOGLinkExposition expo;
       /* If this edge is entering the graph, and we have acquired_at
@@ -3771,6 +3803,7 @@ static void laog__del_edge ( Lock* src, Lock* dst ) {
    UWord      keyW;
    LAOGLinks* links;
    if (0) VG_(printf)("laog__del_edge enter %p %p\n", src, dst);
+   laog_gen++;
    /* Update the out edges for src */
    keyW  = 0;
    links = NULL;
@@ -3950,6 +3983,8 @@ static void laog__pre_thread_acquires_lock (
    UWord*   ls_words;
    UWord    ls_size, i;
    Lock*    other;
+   LAOGCacheEnt* ent;
+   ULong    gen;
 
    /* It may be that 'thr' already holds 'lk' and is recursively
       relocking in.  In this case we just ignore the call. */
@@ -3957,13 +3992,24 @@ static void laog__pre_thread_acquires_lock (
    if (HG_(elemWS)( univ_lsets, thr->locksetA, (UWord)lk ))
       return;
 
-   /* First, the check.  Complain if there is any path in laog from lk
-      to any of the locks already held by thr, since if any such path
-      existed, it would mean that previously lk was acquired before
-      (rather than after, as we are doing here) at least one of those
-      locks.
-   */
-   other = laog__do_dfs_from_to(lk, thr->locksetA);
+   stats__laog_cache_queries++;
+   ent = laog_cache_ent(lk, thr->locksetA);
+   if (ent->lk != lk || ent->lockset != thr->locksetA
+       || ent->gen != laog_gen) {
+      stats__laog_cache_misses++;
+      ent->lk            = lk;
+      ent->lockset       = thr->locksetA;
+      ent->gen           = laog_gen;
+      ent->edges_present = False;
+      /* First, the check.  Complain if there is any path in laog from lk
+         to any of the locks already held by thr, since if any such path
+         existed, it would mean that previously lk was acquired before
+         (rather than after, as we are doing here) at least one of those
+         locks.
+      */
+      ent->other = laog__do_dfs_from_to(lk, thr->locksetA);
+   }
+   other = ent->other;
    if (other) {
       LAOGLinkExposition key, *found;
       /* So we managed to find a path lk --*--> other in the graph,
@@ -4047,11 +4093,19 @@ static void laog__pre_thread_acquires_lock (
       fields must be non-NULL.
    */
    tl_assert(lk->acquired_at);
-   HG_(getPayloadWS)( &ls_words, &ls_size, univ_lsets, thr->locksetA );
-   for (i = 0; i < ls_size; i++) {
-      Lock* old = (Lock*)ls_words[i];
-      tl_assert(old->acquired_at);
-      laog__add_edge( old, lk );
+   if (!ent->edges_present) {
+      HG_(getPayloadWS)( &ls_words, &ls_size, univ_lsets, thr->locksetA );
+      gen = laog_gen;
+      for (i = 0; i < ls_size; i++) {
+         Lock* old = (Lock*)ls_words[i];
+         tl_assert(old->acquired_at);
+         laog__add_edge( old, lk );
+      }
+      /* If ent was valid before adding the edges, it still is. */
+      if (ent->gen == gen) {
+         ent->gen           = laog_gen;
+         ent->edges_present = True;
+      }
    }
 
    /* Why "except_Locks" ?  We're here because a lock is being
@@ -4088,6 +4142,9 @@ static void laog__handle_one_lock_deletion ( Lock* lk )
    UWord preds_size, succs_size, i, j;
    UWord *preds_words, *succs_words;
 
+   /* lk may be reallocated at the same address: forget about it. */
+   laog_gen++;
+
    preds = laog__preds( lk );
    succs = laog__succs( lk );
 
@@ -5738,9 +5795,16 @@ static Bool hg_process_cmd_line_option ( const HChar* arg )
 
    else if VG_BOOL_CLO(arg, "--delta-stacktrace",
                             HG_(clo_delta_stacktrace)) {}
+   else if VG_BOOL_CLO(arg, "--history-private",
+                            HG_(clo_history_private)) {}
 
    else if VG_BINT_CLO(arg, "--conflict-cache-size",
                        HG_(clo_conflict_cache_size), 10*1000, 150*1000*1000) {}
+   else if VG_BINT_CLO(arg, "--conflict-cache-mb",
+                       HG_(clo_conflict_cache_mb), 0, 100*1000) {
+      if (HG_(clo_conflict_cache_mb) > 0 && HG_(clo_conflict_cache_mb) < 4)
+         VG_(fmsg_bad_option)(arg, "must be 0 or at least 4.\n");
+   }
 
    /* "stuvwx" --> stuvwx (binary) */
    else if VG_STR_CLO(arg, "--hg-sanity-flags", tmp_str) {
@@ -5797,7 +5861,13 @@ static void hg_print_usage ( void )
 "        no : always compute a full history stacktrace from unwind info\n"
 "        yes : derive a stacktrace from the previous stacktrace\n"
 "          if there was no call/return or similar instruction\n"
+"    --history-private=no|yes  record the 'full' history of memory accessed\n"
+"                              by only one thread so far? [yes]\n"
 "    --conflict-cache-size=N   size of 'full' history cache [2000000]\n"
+"    --conflict-cache-mb=N     if not 0, memory budget in MB (at least 4)\n"
+"                              of the 'full' history cache and of its\n"
+"                              stack traces, used instead of\n"
+"                              --conflict-cache-size [0]\n"
 "    --check-stack-refs=no|yes race-check reads and writes on the\n"
 "                              main stack and thread stacks? [yes]\n"
 "    --ignore-thread-creation=yes|no Ignore activities during thread\n"
@@ -5879,6 +5949,8 @@ static void hg_print_stats (void)
                   (Int)(laog ? VG_(sizeFM)( laog ) : 0));
       VG_(printf)(" LAOG exposition: %'8d map size\n",
                   (Int)(laog_exposition ? VG_(sizeFM)( laog_exposition ) : 0));
+      VG_(printf)("      LAOG cache: %'8lu queries, %'lu misses\n",
+                  stats__laog_cache_queries, stats__laog_cache_misses);
    }
 
    VG_(printf)("           locks: %'8lu acquires, "
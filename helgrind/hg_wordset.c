@@ -53,74 +53,62 @@ typedef
    struct { UWord arg1; UWord arg2; UWord res; }
    WCacheEnt;
 
-/* Each cache is a fixed sized array of N_WCACHE_STAT_MAX entries.
-   However only the first .dynMax are used.  This is because at some
-   point, expanding the cache further overall gives a slowdown because
-   searching more entries more than negates any performance advantage
-   from caching those entries in the first place.  Hence use .dynMax
-   to allow the size of the cache(s) to be set differently for each
-   different WordSetU. */
-#define N_WCACHE_STAT_MAX 32
+/* Each cache is a direct-mapped array of N_WCACHE_STAT_MAX entries,
+   indexed by a hash of the two arguments.  However only the first
+   .dynMax are used, so as to allow the size of the cache(s) to be set
+   differently for each different WordSetU.  .dynMax must be a power
+   of 2.  Since a lookup only looks at one entry, bigger caches do not
+   make lookups slower.  An entry with .arg1 == WCache_EMPTY is unused:
+   this can't be a valid WordSet. */
+#define N_WCACHE_STAT_MAX 256
+#define WCache_EMPTY      (~(UWord)0)
 typedef
    struct {
       WCacheEnt ent[N_WCACHE_STAT_MAX];
-      UWord     dynMax; /* 1 .. N_WCACHE_STAT_MAX inclusive */
-      UWord     inUse;  /* 0 .. dynMax inclusive */
+      UWord     dynMax; /* 1 .. N_WCACHE_STAT_MAX inclusive, power of 2 */
    }
    WCache;
 
+#define WCache_IX(_cache,_arg1,_arg2)                                \
+   (((_arg1) * 0x9E3779B1UL ^ (_arg2) ^ ((_arg2) >> 7))              \
+    & ((_cache)->dynMax - 1))
+
+#define WCache_CLEAR(_zzcache)                                       \
+   do {                                                              \
+      VG_(memset)((_zzcache).ent, 0xFF,                              \
+                  (_zzcache).dynMax * sizeof(WCacheEnt));            \
+   } while (0)
+
 #define WCache_INIT(_zzcache,_zzdynmax)                              \
    do {                                                              \
       tl_assert((_zzdynmax) >= 1);                                   \
       tl_assert((_zzdynmax) <= N_WCACHE_STAT_MAX);                   \
+      tl_assert(((_zzdynmax) & ((_zzdynmax) - 1)) == 0);             \
       (_zzcache).dynMax = (_zzdynmax);                               \
-      (_zzcache).inUse = 0;                                          \
+      WCache_CLEAR(_zzcache);                                        \
    } while (0)
 
 #define WCache_LOOKUP_AND_RETURN(_retty,_zzcache,_zzarg1,_zzarg2)    \
    do {                                                              \
-      UWord   _i;                                                    \
-      UWord   _arg1  = (UWord)(_zzarg1);                             \
-      UWord   _arg2  = (UWord)(_zzarg2);                             \
-      WCache* _cache = &(_zzcache);                                  \
-      tl_assert(_cache->dynMax >= 1);                                \
-      tl_assert(_cache->dynMax <= N_WCACHE_STAT_MAX);                \
-      tl_assert(_cache->inUse >= 0);                                 \
-      tl_assert(_cache->inUse <= _cache->dynMax);                    \
-      if (_cache->inUse > 0) {                                       \
-         if (_cache->ent[0].arg1 == _arg1                            \
-             && _cache->ent[0].arg2 == _arg2)                        \
-            return (_retty)_cache->ent[0].res;                       \
-         for (_i = 1; _i < _cache->inUse; _i++) {                    \
-            if (_cache->ent[_i].arg1 == _arg1                        \
-                && _cache->ent[_i].arg2 == _arg2) {                  \
-               WCacheEnt tmp     = _cache->ent[_i-1];                \
-               _cache->ent[_i-1] = _cache->ent[_i];                  \
-               _cache->ent[_i]   = tmp;                              \
-               return (_retty)_cache->ent[_i-1].res;                 \
-            }                                                        \
-         }                                                           \
-      }                                                              \
+      UWord      _arg1  = (UWord)(_zzarg1);                          \
+      UWord      _arg2  = (UWord)(_zzarg2);                          \
+      WCache*    _cache = &(_zzcache);                               \
+      WCacheEnt* _ent   = &_cache->ent[WCache_IX(_cache,_arg1,_arg2)]; \
+      tl_assert(_arg1 != WCache_EMPTY);                              \
+      if (_ent->arg1 == _arg1 && _ent->arg2 == _arg2)                \
+         return (_retty)_ent->res;                                   \
    } while (0)
 
 #define WCache_UPDATE(_zzcache,_zzarg1,_zzarg2,_zzresult)            \
    do {                                                              \
-      Word    _i;                                                    \
-      UWord   _arg1  = (UWord)(_zzarg1);                             \
-      UWord   _arg2  = (UWord)(_zzarg2);                             \
-      UWord   _res   = (UWord)(_zzresult);                           \
-      WCache* _cache = &(_zzcache);                                  \
-      tl_assert(_cache->dynMax >= 1);                                \
-      tl_assert(_cache->dynMax <= N_WCACHE_STAT_MAX);                \
-      tl_assert(_cache->inUse >= 0);                                 \
-      tl_assert(_cache->inUse <= _cache->dynMax);                    \
-      if (_cache->inUse < _cache->dynMax)                            \
-         _cache->inUse++;                                            \
-      for (_i = _cache->inUse-1; _i >= 1; _i--)                      \
-         _cache->ent[_i] = _cache->ent[_i-1];                        \
-      _cache->ent[0].arg1 = _arg1;                                   \
-      _cache->ent[0].arg2 = _arg2;                                   \
-      _cache->ent[0].res  = _res;                                    \
+      UWord      _arg1  = (UWord)(_zzarg1);                          \
+      UWord      _arg2  = (UWord)(_zzarg2);                          \
+      UWord      _res   = (UWord)(_zzresult);                        \
+      WCache*    _cache = &(_zzcache);                               \
+      WCacheEnt* _ent   = &_cache->ent[WCache_IX(_cache,_arg1,_arg2)]; \
+      _ent->arg1 = _arg1;                                            \
+      _ent->arg2 = _arg2;                                            \
+      _ent->res  = _res;                                             \
    } while (0)
 
 
@@ -484,10 +472,10 @@ void HG_(dieWS) ( WordSetU* wsu, WordSet ws )
 
    delete_WV( wv );
 
-   wsu->cache_addTo.inUse = 0;
-   wsu->cache_delFrom.inUse = 0;
-   wsu->cache_intersect.inUse = 0;
-   wsu->cache_minus.inUse = 0;
+   WCache_CLEAR(wsu->cache_addTo);
+   WCache_CLEAR(wsu->cache_delFrom);
+   WCache_CLEAR(wsu->cache_intersect);
+   WCache_CLEAR(wsu->cache_minus);
 }
 
 Bool HG_(plausibleWS) ( WordSetU* wsu, WordSet ws )
@@ -567,13 +567,22 @@ static inline LineF *LineF_Ptr (LineZ *lineZ)
    Z rep: .dict[0] from SVal_INVALID to other   -- rcinc_LineZ
 */
 
+/* With --history-private=no, .owner is the only thread whose accesses
+   have changed the state of the SecMap's memory, SecMap_NO_OWNER if
+   no thread has done so yet, or SecMap_SHARED once a second thread
+   has.  See shmem__note_access_by. */
 typedef
    struct {
       UInt   magic;
+      ThrID  owner;
       LineZ  linesZ[N_SECMAP_ZLINES];
    }
    SecMap;
 
+/* Neither value is a valid ThrID, see NB2 above. */
+#define SecMap_NO_OWNER ((ThrID)0)
+#define SecMap_SHARED   ((ThrID)1)
+
 #define SecMap_MAGIC   0x571e58cbU
 
 // (UInt) `echo "Free SecMap" | md5sum`
@@ -624,6 +633,7 @@ static UWord stats__secmaps_in_map_shmem = 0; // # SecMaps 'live'
 static UWord stats__secmaps_scanGC       = 0; // # nr of scan GC done.
 static UWord stats__secmaps_scanGCed     = 0; // # SecMaps GC-ed via scan
 static UWord stats__secmaps_ssetGCed     = 0; // # SecMaps GC-ed via setnoaccess
+static UWord stats__secmaps_shared       = 0; // # SecMaps made shared
 static UWord stats__secmap_ga_space_covered = 0; // # ga bytes covered
 static UWord stats__secmap_linesZ_allocd = 0; // # LineZ's issued
 static UWord stats__secmap_linesZ_bytes  = 0; // .. using this much storage
@@ -793,6 +803,7 @@ static SecMap* shmem__alloc_or_recycle_SecMap ( void )
    if (0) VG_(printf)("alloc_SecMap %p\n",sm);
    tl_assert(sm);
    sm->magic = SecMap_MAGIC;
+   sm->owner = SecMap_NO_OWNER;
    for (i = 0; i < N_SECMAP_ZLINES; i++) {
       sm->linesZ[i].dict[0] = SVal_NOACCESS;
       sm->linesZ[i].dict[1] = SVal_INVALID;
@@ -963,6 +974,30 @@ static SecMap* shmem__find_or_alloc_SecMap ( Addr ga )
    }
 }
 
+/* Note that thread 'thrid' has changed the state of the memory at 'a',
+   and return True if the SecMap holding 'a' is shared, that is, if
+   the access must be recorded in the conflicting-access history.
+   Accesses to a SecMap owned by a single thread are not recorded:
+   if a second thread then races with one of them, the race is
+   reported without the previous access. */
+static inline Bool shmem__note_access_by ( Addr a, ThrID thrid )
+{
+   SecMap* sm = shmem__find_SecMap ( a );
+   if (UNLIKELY(!sm))
+      return True;
+   if (LIKELY(sm->owner == thrid))
+      return False;
+   if (sm->owner == SecMap_NO_OWNER) {
+      sm->owner = thrid;
+      return False;
+   }
+   if (sm->owner != SecMap_SHARED) {
+      sm->owner = SecMap_SHARED;
+      stats__secmaps_shared++;
+   }
+   return True;
+}
+
 /* Returns the nr of linesF which are in use. Note: this is scanning
    the secmap wordFM. So, this is to be used for statistics only. */
 __attribute__((noinline))
@@ -2677,6 +2712,26 @@ ULong VTS__indexAt_SLOW ( VTS* vts, Thr* idx )
 }
 
 
+/* Return vts[thrid], using the fact that .ts is sorted by thrid.
+*/
+static ULong VTS__indexAt_ThrID ( const VTS* vts, ThrID thrid )
+{
+   UWord lo = 0;
+   UWord hi = vts->usedTS;
+   while (lo < hi) {
+      UWord mid = (lo + hi) / 2;
+      const ScalarTS* st = &vts->ts[mid];
+      if (st->thrid == thrid)
+         return st->tym;
+      if (st->thrid < thrid)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+   return 0;
+}
+
+
 /* See comment on prototype above.
 */
 static void VTS__declare_thread_very_dead ( Thr* thr )
@@ -2785,6 +2840,17 @@ static void VtsID__invalidate_caches ( void ); /* fwds */
    - .vts->id == this entry number
    - no specific value for .rc (even 0 is OK)
    - this entry is not on freelist, so u.freelink == VtsID_INVALID
+
+   .epoch, if .epoch.thrid != 0, says that .vts has been the write
+   clock of thread .epoch.thrid while that thread's own clock was
+   .epoch.tym.  A thread's own clock is ticked each time it hands its
+   clocks to another thread (libhb_so_send, libhb_create), so any
+   thread clock, or join of thread clocks, which knows the epoch
+   (has an entry >= .epoch.tym for .epoch.thrid) knows all of .vts.
+   Comparing .vts against such a VTS is then an O(1) epoch check
+   instead of a full VTS comparison (see VtsID__cmpLEQ_WRK).  This only
+   holds for write clocks: a read clock can be bigger than what a
+   strong receiver gets.
 */
 typedef
    struct {
@@ -2796,6 +2862,7 @@ typedef
       } u; 
       /* u.freelink only used when vts == NULL,
          u.remap only used when vts != NULL, during pruning. */
+      ScalarTS epoch; /* thrid 0 if .vts is not known as a write clock */
    }
    VtsTE;
 
@@ -2858,6 +2925,8 @@ static VtsID get_new_VtsID ( void )
    te.vts = NULL;
    te.rc = 0;
    te.u.freelink = VtsID_INVALID;
+   te.epoch.thrid = 0;
+   te.epoch.tym = 0;
    ii = (VtsID)VG_(addToXA)( vts_tab, &te );
    return ii;
 }
@@ -2911,6 +2980,8 @@ static VtsID vts_tab__find__or__clone_and_add ( VTS* cand )
       ie->vts = in_tab;
       ie->rc = 0;
       ie->u.freelink = VtsID_INVALID;
+      ie->epoch.thrid = 0;
+      ie->epoch.tym = 0;
       in_tab->id = ii;
       return ii;
    }
@@ -3203,6 +3274,8 @@ static void vts_tab__do_GC ( Bool show_stats )
          new_te.vts      = new_vts;
          new_te.rc       = 0;
          new_te.u.freelink = VtsID_INVALID;
+         new_te.epoch.thrid = 0;
+         new_te.epoch.tym   = 0;
          Word j = VG_(addToXA)( new_tab, &new_te );
          tl_assert(j <= i);
          tl_assert(j == new_VtsID_ctr - 1);
@@ -3394,6 +3467,7 @@ static VTS* temp_max_sized_VTS = NULL;
 //////////////////////////
 static ULong stats__cmpLEQ_queries = 0;
 static ULong stats__cmpLEQ_misses  = 0;
+static ULong stats__cmpLEQ_epoch   = 0;
 static ULong stats__join2_queries  = 0;
 static ULong stats__join2_misses   = 0;
 
@@ -3463,6 +3537,19 @@ static Bool VtsID__cmpLEQ_WRK ( VtsID vi1, VtsID vi2 ) {
    tl_assert(vi1 != vi2);
    ////++
    stats__cmpLEQ_queries++;
+   /* If vi1 is a write clock of a known epoch, vi1 <= vi2 iff vi2 knows
+      that epoch.  See comments on VtsTE.epoch. */
+   { const VtsTE* te1 = VG_(indexXA)( vts_tab, vi1 );
+     if (te1->epoch.thrid != 0) {
+        stats__cmpLEQ_epoch++;
+        leq = VTS__indexAt_ThrID( VtsID__to_VTS(vi2), te1->epoch.thrid )
+                 >= te1->epoch.tym;
+        if (CHECK_MSM)
+           tl_assert(leq == (VTS__cmpLEQ( te1->vts,
+                                          VtsID__to_VTS(vi2) ) == 0));
+        return leq;
+     }
+   }
    hash = hash_VtsIDs(vi1, vi2, N_CMPLEQ_CACHE);
    if (cmpLEQ_cache[hash].vi1 == vi1
        && cmpLEQ_cache[hash].vi2 == vi2)
@@ -3530,6 +3617,16 @@ static VtsID VtsID__tick ( VtsID vi, Thr* idx ) {
    return vts_tab__find__or__clone_and_add(temp_max_sized_VTS);
 }
 
+/* Record that vi is now the write clock of thr, see VtsTE.epoch. */
+static void VtsID__set_write_epoch ( VtsID vi, Thr* thr ) {
+   VtsTE* te    = VG_(indexXA)( vts_tab, vi );
+   ThrID  thrid = Thr__to_ThrID(thr);
+   tl_assert(te->vts);
+   te->epoch.thrid = thrid;
+   te->epoch.tym   = VTS__indexAt_ThrID( te->vts, thrid );
+   tl_assert(te->epoch.tym > 0);
+}
+
 /* index into a VTS (only for assertions) */
 static ULong VtsID__indexAt ( VtsID vi, Thr* idx ) {
    VTS* vts = VtsID__to_VTS(vi);
@@ -4258,6 +4355,11 @@ static inline SVal Ptr2SVal (void* ptr)
       of course decrement the reference count on the RCEC it
       refers to, in order that entries from (1) eventually get
       discarded too.
+      With --conflict-cache-mb, the budget is instead shared out once
+      and for all between the fixed part of (1), the OldRefs and the
+      RCECs: see set_oldref_and_rcec_max_n.  Each OldRef can keep at
+      most one RCEC referenced, so an RCEC GC is done when the nr of
+      RCECs reaches twice the maximum nr of OldRef.
 */
 
 static UWord stats__evm__lookup_found = 0;
@@ -4797,7 +4899,7 @@ static Word cmp_oldref_tsw (const void* node1, const void* node2 )
 //////////// BEGIN OldRef pool allocator
 static PoolAlloc* oldref_pool_allocator;
 // Note: We only allocate elements in this pool allocator, we never free them.
-// We stop allocating elements at VG_(clo_conflict_cache_size).
+// We stop allocating elements at oldref_max_n.
 //////////// END OldRef pool allocator
 
 static OldRef mru; 
@@ -4843,12 +4945,39 @@ static UWord     oldrefHTN    = 0;    /* # elems in oldrefHT */
    the nr of elements that were allocated from the OldRef pool allocator
    as we never free an OldRef : we just re-use them. */
 
+static UWord oldref_max_n = 0; /* Maximum nr of OldRef. */
+static UWord rcec_max_n   = 0; /* If not 0, maximum nr of RCEC. */
+static UWord stats__ctxt_rcec_max_gcs = 0;
+
+/* Sets oldref_max_n and rcec_max_n.  With --conflict-cache-mb, each
+   OldRef is charged with itself, with the up to 2 chains per element
+   of oldrefHT and the old chains while it is resized, and with 2 RCECs.
+   The contextTab and one pool of each pool allocator, as they allocate
+   1000 elements at a time, are charged first. */
+static void set_oldref_and_rcec_max_n ( void )
+{
+   ULong budget, fixed_szB, per_oldref_szB;
+
+   if (LIKELY(HG_(clo_conflict_cache_mb) == 0)) {
+      oldref_max_n = HG_(clo_conflict_cache_size);
+      rcec_max_n   = 0;
+      return;
+   }
+   budget         = ((ULong)HG_(clo_conflict_cache_mb)) << 20;
+   fixed_szB      = N_RCEC_TAB * sizeof(RCEC*)
+                    + 1000 * (sizeof(OldRef) + sizeof(RCEC));
+   per_oldref_szB = sizeof(OldRef) + 3 * sizeof(OldRef*) + 2 * sizeof(RCEC);
+   /* --conflict-cache-mb is at least 4. */
+   tl_assert (budget > fixed_szB + 1000 * per_oldref_szB);
+   oldref_max_n   = (budget - fixed_szB) / per_oldref_szB;
+   rcec_max_n     = 2 * oldref_max_n;
+}
 
 /* allocates a new OldRef or re-use the lru one if all allowed OldRef
    have already been allocated. */
 static OldRef* alloc_or_reuse_OldRef ( void )
 {
-   if (oldrefHTN < HG_(clo_conflict_cache_size)) {
+   if (oldrefHTN < oldref_max_n) {
       oldrefHTN++;
       return VG_(allocEltPA) ( oldref_pool_allocator );
    } else {
@@ -4889,6 +5018,8 @@ static inline Word cmp_nonempty_intervals ( Addr a1, SizeT n1,
 
 static UWord event_map_stamp = 0; // Used to stamp each OldRef when touched.
 
+static void do_RCEC_GC ( void ); /* fwds */
+
 static void event_map_bind ( Addr a, SizeT szB, Bool isW, Thr* thr )
 {
    OldRef  example;
@@ -4901,6 +5032,14 @@ static void event_map_bind ( Addr a, SizeT szB, Bool isW, Thr* thr )
 
    WordSetID locksHeldW = thr->hgthread->locksetW;
 
+   /* With --conflict-cache-mb, discard the unreferenced RCECs before
+      allocating one more than rcec_max_n.  As at most oldref_max_n
+      RCECs are referenced, this frees at least half of them. */
+   if (UNLIKELY(rcec_max_n > 0 && stats__ctxt_tab_curr >= rcec_max_n)) {
+      stats__ctxt_rcec_max_gcs++;
+      do_RCEC_GC();
+   }
+
    rcec = get_RCEC( thr );
 
    /* Look in the oldrefHT to see if we already have a record for this
@@ -5130,6 +5269,7 @@ static void event_map_init ( void )
    oldrefHT = VG_(HT_construct) ("libhb.event_map_init.4 (oldref hashtable)");
 
    oldrefHTN = 0;
+   set_oldref_and_rcec_max_n();
    mru.prev = &lru;
    mru.next = NULL;
    lru.prev = NULL;
@@ -5466,7 +5606,9 @@ static inline SVal msmcread ( SVal svOld,
    if (UNLIKELY(svNew != svOld)) {
       tl_assert(svNew != SVal_INVALID);
       if (HG_(clo_history_level) >= 2
-          && SVal__isC(svOld) && SVal__isC(svNew)) {
+          && SVal__isC(svOld) && SVal__isC(svNew)
+          && (HG_(clo_history_private)
+              || shmem__note_access_by( acc_addr, acc_thr->thrid ))) {
          event_map_bind( acc_addr, szB, False/*!isWrite*/, acc_thr );
          stats__msmcread_change++;
       }
@@ -5539,7 +5681,9 @@ static inline SVal msmcwrite ( SVal svOld,
    if (UNLIKELY(svNew != svOld)) {
       tl_assert(svNew != SVal_INVALID);
       if (HG_(clo_history_level) >= 2
-          && SVal__isC(svOld) && SVal__isC(svNew)) {
+          && SVal__isC(svOld) && SVal__isC(svNew)
+          && (HG_(clo_history_private)
+              || shmem__note_access_by( acc_addr, acc_thr->thrid ))) {
          event_map_bind( acc_addr, szB, True/*isWrite*/, acc_thr );
          stats__msmcwrite_change++;
       }
@@ -6581,6 +6725,7 @@ Thr* libhb_init (
    vi  = VtsID__mk_Singleton( thr, 1 );
    thr->viR = vi;
    thr->viW = vi;
+   VtsID__set_write_epoch( thr->viW, thr );
    VtsID__rcinc(thr->viR);
    VtsID__rcinc(thr->viW);
 
@@ -6599,6 +6744,7 @@ Thr* libhb_create ( Thr* parent )
 
    child->viR = VtsID__tick( parent->viR, child );
    child->viW = VtsID__tick( parent->viW, child );
+   VtsID__set_write_epoch( child->viW, child );
    Filter__clear(child->filter, "libhb_create(child)");
    VtsID__rcinc(child->viR);
    VtsID__rcinc(child->viW);
@@ -6614,6 +6760,7 @@ Thr* libhb_create ( Thr* parent )
    VtsID__rcdec(parent->viW);
    parent->viR = VtsID__tick( parent->viR, parent );
    parent->viW = VtsID__tick( parent->viW, parent );
+   VtsID__set_write_epoch( parent->viW, parent );
    Filter__clear(parent->filter, "libhb_create(parent)");
    VtsID__rcinc(parent->viR);
    VtsID__rcinc(parent->viW);
@@ -6655,6 +6802,9 @@ void libhb_shutdown ( Bool show_stats )
                   stats__secmaps_ssetGCed);
       VG_(printf)(" secmaps: %'10lu searches (%'12lu slow)\n",
                   stats__secmaps_search, stats__secmaps_search_slow);
+      if (!HG_(clo_history_private))
+         VG_(printf)(" secmaps: %'10lu made shared\n",
+                     stats__secmaps_shared);
 
       VG_(printf)("%s","\n");
       VG_(printf)("   cache: %'lu totrefs (%'lu misses)\n",
@@ -6709,8 +6859,10 @@ void libhb_shutdown ( Bool show_stats )
                   stats__msmcread, stats__msmcread_change);
       VG_(printf)("   libhb: %'13llu msmcwrite (%'llu dragovers)\n",
                   stats__msmcwrite, stats__msmcwrite_change);
-      VG_(printf)("   libhb: %'13llu cmpLEQ queries (%'llu misses)\n",
-                  stats__cmpLEQ_queries, stats__cmpLEQ_misses);
+      VG_(printf)("   libhb: %'13llu cmpLEQ queries (%'llu epoch, "
+                  "%'llu misses)\n",
+                  stats__cmpLEQ_queries, stats__cmpLEQ_epoch,
+                  stats__cmpLEQ_misses);
       VG_(printf)("   libhb: %'13llu join2  queries (%'llu misses)\n",
                   stats__join2_queries, stats__join2_misses);
 
@@ -6773,6 +6925,11 @@ void libhb_shutdown ( Bool show_stats )
       VG_(printf)("%s","\n");
       VG_(printf)( "   libhb: oldrefHTN %lu (%'d bytes)\n",
                    oldrefHTN, (int)(oldrefHTN * sizeof(OldRef)));
+      if (HG_(clo_conflict_cache_mb) > 0)
+         VG_(printf)( "   libhb: oldref budget %lu MB, max %'lu,"
+                      " rcec max %'lu, rcec max GCs %'lu\n",
+                      HG_(clo_conflict_cache_mb), oldref_max_n,
+                      rcec_max_n, stats__ctxt_rcec_max_gcs);
       tl_assert (oldrefHTN == VG_(HT_count_nodes) (oldrefHT));
       VG_(printf)( "   libhb: oldref lookup found=%lu notfound=%lu\n",
                    stats__evm__lookup_found, stats__evm__lookup_notfound);
@@ -6979,6 +7136,7 @@ void libhb_so_send ( Thr* thr, SO* so, Bool strong_send )
    VtsID__rcdec(thr->viW);
    thr->viR = VtsID__tick( thr->viR, thr );
    thr->viW = VtsID__tick( thr->viW, thr );
+   VtsID__set_write_epoch( thr->viW, thr );
    if (!thr->llexit_done) {
       Filter__clear(thr->filter, "libhb_so_send");
       note_local_Kw_n_stack_for(thr);
@@ -7022,6 +7180,7 @@ void libhb_so_recv ( Thr* thr, SO* so, Bool strong_recv )
       if (strong_recv) {
          VtsID__rcdec(thr->viW);
          thr->viW = VtsID__join2( thr->viW, so->viW );
+         VtsID__set_write_epoch( thr->viW, thr );
          VtsID__rcinc(thr->viW);
 
          /* See comment just above, re r10589. */
@@ -0,0 +1,63 @@
+/* Access many more memory locations, from many more distinct stack
+   traces, than a --conflict-cache-mb budget above the 10000 entries
+   minimum of --conflict-cache-size can remember, so that both the
+   maximum number of remembered accesses and the maximum number of
+   stack traces are reached.  No race is expected: the second thread
+   only ensures that the history is recorded. */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N 16   /* functions per call level */
+
+#define FOR_EACH(m) m(0) m(1) m(2) m(3) m(4) m(5) m(6) m(7) \
+                    m(8) m(9) m(10) m(11) m(12) m(13) m(14) m(15)
+#define LIST(p) p##0, p##1, p##2, p##3, p##4, p##5, p##6, p##7, \
+                p##8, p##9, p##10, p##11, p##12, p##13, p##14, p##15
+
+/* a<i> calls b<j> calls c<k> calls d<l>, which writes: each of the
+   N*N*N*N writes has its own stack trace. */
+#define D(n) static void d##n ( int* w ) { *w = n; }
+FOR_EACH(D)
+static void (*const d_fns[N]) ( int* ) = { LIST(d) };
+
+#define C(n) static void c##n ( int* w, int l ) { d_fns[l](w); }
+FOR_EACH(C)
+static void (*const c_fns[N]) ( int*, int ) = { LIST(c) };
+
+#define B(n) static void b##n ( int* w, int k, int l ) { c_fns[k](w, l); }
+FOR_EACH(B)
+static void (*const b_fns[N]) ( int*, int, int ) = { LIST(b) };
+
+#define A(n) static void a##n ( int* w, int j, int k, int l ) \
+                { b_fns[j](w, k, l); }
+FOR_EACH(A)
+static void (*const a_fns[N]) ( int*, int, int, int ) = { LIST(a) };
+
+static void* child ( void* arg )
+{
+   return arg;
+}
+
+int main ( void )
+{
+   pthread_t t;
+   int* words = calloc(N * N * N * N, sizeof(int));
+   int  i, j, k, l, sum = 0;
+
+   if (words == NULL)
+      return 1;
+   pthread_create(&t, NULL, child, NULL);
+   for (i = 0; i < N; i++)
+      for (j = 0; j < N; j++)
+         for (k = 0; k < N; k++)
+            for (l = 0; l < N; l++)
+               a_fns[i](&words[((i * N + j) * N + k) * N + l], j, k, l);
+   for (i = 0; i < N * N * N * N; i++)
+      sum += words[i];
+   pthread_join(t, NULL);
+   free(words);
+   printf("sum %d\n", sum);
+   return 0;
+}
@@ -0,0 +1,49 @@
+/* A race on memory which was private to the child thread until the
+   racing access by the parent.  With --history-private=no, the
+   accesses of the child are not recorded, so the race is reported
+   without the stack of the previous access. */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <time.h>
+
+/* A whole 8192 bytes chunk of memory, only accessed by the child until
+   the race. */
+static char* chunk;
+
+static void* child_fn ( void* arg )
+{
+   int i;
+   for (i = 0; i < 8192; i++)
+      chunk[i] = 1;
+   return NULL;
+}
+
+int main ( void )
+{
+   const struct timespec delay = { 0, 100 * 1000 * 1000 };
+   pthread_t child;
+   char* p = mmap(NULL, 2 * 8192, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+   if (p == MAP_FAILED) {
+      perror("mmap");
+      exit(1);
+   }
+   chunk = (char*)(((uintptr_t)p + 8191) & ~(uintptr_t)8191);
+   if (pthread_create(&child, NULL, child_fn, NULL)) {
+      perror("pthread_create");
+      exit(1);
+   }
+   nanosleep(&delay, 0);
+   chunk[100] = 2;
+
+   if (pthread_join(child, NULL)) {
+      perror("pthread join");
+      exit(1);
+   }
+   return 0;
+}
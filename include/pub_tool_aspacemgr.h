@@ -156,6 +156,12 @@ extern void* VG_(am_shadow_alloc)(SizeT size);
    accordingly.  This fails if the range isn't valid for valgrind. */
 extern SysRes VG_(am_munmap_valgrind)( Addr start, SizeT length );
 
+/* Tell the kernel that the page-aligned client heap area
+   [start, start+len) is no longer needed, so its pages can be freed;
+   their contents read back as zeroes.  Returns False, doing nothing,
+   if the area is not all client heap or the OS does not support it. */
+extern Bool VG_(am_discard_client_heap_pages)( Addr start, SizeT len );
+
 #endif   // __PUB_TOOL_ASPACEMGR_H
 
 /*--------------------------------------------------------------------*/
@@ -79,6 +79,20 @@ void*        VG_(get_error_extra)   ( const Error* err );
 extern void VG_(maybe_record_error) ( ThreadId tid, ErrorKind ekind,
                                       Addr a, const HChar* s, void* extra );
 
+/* Similar to VG_(maybe_record_error)(), for errors that a tool can detect
+   at a very high rate, such as data races in a loop.  'key' is chosen by
+   the tool: two errors of kind 'ekind' with the same key must be equal
+   according to the tool's eq_Error function.  With
+   --fast-error-counting=yes, if an error with the same kind and key was
+   recently recorded, and not suppressed, from the same IP, SP and caller,
+   it is counted again without computing a stack trace nor searching the
+   recorded errors.  Only the first caller of the current function is
+   looked at, so an error differing only by the callers further up can
+   be counted as an occurrence of the cached one. */
+extern void VG_(maybe_record_error_at_ip) ( ThreadId tid, ErrorKind ekind,
+                                            Addr a, const HChar* s,
+                                            void* extra, UWord key );
+
 /* Similar to VG_(maybe_record_error)(), except this one doesn't record the
    error -- useful for errors that can only happen once.  The errors can be
    suppressed, though.  Return value is True if it was suppressed.
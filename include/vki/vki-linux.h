@@ -1312,6 +1312,8 @@ struct  vki_seminfo {
 #define VKI_MREMAP_MAYMOVE	1
 #define VKI_MREMAP_FIXED	2
 
+#define VKI_MADV_DONTNEED	4
+
 //----------------------------------------------------------------------
 // From linux-2.6.31-rc4/include/linux/futex.h
 //----------------------------------------------------------------------
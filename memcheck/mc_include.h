@@ -618,6 +618,15 @@ extern Long MC_(clo_freelist_vol);
    in the "big block" freed blocks queue. */
 extern Long MC_(clo_freelist_big_blocks);
 
+/* Number of bytes of whole pages inside freed blocks that were given
+   back to the OS while the blocks were queued. */
+extern Long MC_(free_queue_discarded_volume);
+
+/* Number of heap blocks allocated at sampled and unsampled sites,
+   see MC_(clo_alloc_site_sampling). */
+extern ULong MC_(n_sampled_blocks);
+extern ULong MC_(n_unsampled_blocks);
+
 /* Do leak check at exit?  default: NO */
 extern LeakCheckMode MC_(clo_leak_check);
 
@@ -667,6 +676,16 @@ typedef
    Default : all heuristics. */
 extern UInt MC_(clo_leak_check_heuristics);
 
+/* In leak check, reuse the scan results of the previous leak search for
+   the pages that have not been written since.  Default: NO. */
+extern Bool MC_(clo_leak_check_incremental);
+
+/* Geometry of the origin tracking cache used by --track-origins=yes:
+   the number of sets (a power of 2, default 2^19) and the number of
+   lines per set (2, 4, 8 or 16, default 4). */
+extern Int MC_(clo_origin_cache_sets);
+extern Int MC_(clo_origin_cache_ways);
+
 /* Assume accesses immediately below %esp are due to gcc-2.96 bugs.
  * default: NO */
 extern Bool MC_(clo_workaround_gcc296_bugs);
@@ -694,6 +713,14 @@ typedef
    KeepStacktraces;
 extern KeepStacktraces MC_(clo_keep_stacktraces);
 
+/* Percentage (0 .. 100) of allocation sites whose heap blocks are fully
+   checked.  The choice is made per allocation stack trace, so all the
+   blocks allocated at a given site are either checked or not.  Blocks
+   from unchecked sites are marked as defined when allocated and are
+   released immediately when freed, instead of going through the freed
+   blocks queue.  default: 100 */
+extern Int MC_(clo_alloc_site_sampling);
+
 /* Indicates the level of instrumentation/checking done by Memcheck.
 
    1 = No undefined value checking, Addrcheck-style behaviour only:
@@ -34,6 +34,7 @@
 #include "pub_tool_hashtable.h"
 #include "pub_tool_libcbase.h"
 #include "pub_tool_libcassert.h"
+#include "pub_tool_libcfile.h"
 #include "pub_tool_libcprint.h"
 #include "pub_tool_libcsignal.h"
 #include "pub_tool_machine.h"
@@ -457,6 +458,13 @@ static MC_Chunk** lc_chunks;
 // How many chunks we're dealing with.
 static Int        lc_n_chunks;
 static SizeT lc_chunks_n_frees_marker;
+// [lc_chunks_min_addr, lc_chunks_max_addr[ covers every chunk in lc_chunks.
+// Most scanned words are not heap pointers (small integers, code and
+// stack addresses, ...): this range lets lc_is_a_chunk_ptr reject them
+// without an aspacemgr lookup or a binary search of lc_chunks.
+// Both are 0 when there are no chunks.
+static Addr lc_chunks_min_addr;
+static Addr lc_chunks_max_addr;
 // This has the same number of entries as lc_chunks, and each entry
 // in lc_chunks corresponds with the entry here (ie. lc_chunks[i] and
 // lc_extras[i] describe the same block).
@@ -528,6 +536,11 @@ lc_is_a_chunk_ptr(Addr ptr, Int* pch_no, MC_Chunk** pch, LC_Extra** pex)
    MC_Chunk* ch;
    LC_Extra* ex;
 
+   // Quickest filter: ptr cannot point into a chunk if it is outside
+   // the address range spanned by all the chunks.
+   if (ptr < lc_chunks_min_addr || ptr >= lc_chunks_max_addr)
+      return False;
+
    // Quick filter. Note: implemented with am, not with get_vabits2
    // as ptr might be random data pointing anywhere. On 64 bit
    // platforms, getting va bits for random data can be quite costly
@@ -1001,6 +1014,245 @@ lc_push_if_a_chunk_ptr(Addr ptr,
 }
 
 
+/*------------------------------------------------------------*/
+/*--- Incremental leak search: clean pages                 ---*/
+/*------------------------------------------------------------*/
+
+// With --leak-check-incremental=yes, lc_scan_memory remembers the pages
+// it has fully scanned without finding any word that could point into a
+// chunk.  For such a page, we record the gap ]below, above[ of word values
+// around the chunk address range: no word of the page lies in this gap.
+// At the next leak search, if the page has not been written since, and
+// if the new chunk address range still lies within the gap, the page
+// cannot contain a chunk pointer and does not need to be scanned again.
+//
+// "Not written since" is obtained from the Linux soft-dirty page bits:
+// all the soft-dirty bits are cleared at the end of each incremental leak
+// search, and any write to a page (by the client, the kernel or valgrind)
+// sets the bit of this page again.  This is not free: the clearing
+// write-protects every page of the process, including valgrind's shadow
+// memory and translation cache, so the first write to each page after a
+// leak search takes a page fault.  Writes done by other processes to
+// shared memory are not seen this way, so only private anonymous
+// segments are handled.  Note that a page which has become zero-filled
+// (e.g. by madvise DONTNEED) might look unwritten, but a zero word can
+// never point into a chunk.
+//
+// An LC_CleanPage computed or confirmed during the leak search which
+// cleared the soft-dirty bits for the n-th time has gen n: it is valid
+// during the next search if it has gen lc_clean_gen.  It is also valid in
+// the search that computed it (gen lc_clean_gen+1), as the client does
+// not run during a leak search.
+typedef
+   struct _LC_CleanPage {
+      struct _LC_CleanPage* next;
+      UWord key;    // page address
+      Addr  below;  // Largest word value below the chunk range (or 0).
+      Addr  above;  // Smallest word value above the chunk range (or ~0).
+      UInt  gen;
+   }
+   LC_CleanPage;
+
+static VgHashTable* lc_clean_pages = NULL;
+static UInt         lc_clean_gen = 0;
+
+// True if the current leak search uses and records clean pages.
+static Bool lc_incremental = False;
+
+// How many bytes were not scanned again because they were in clean pages.
+static SizeT lc_clean_skipped_szB;
+
+#if defined(VGO_linux)
+#define PM_SOFT_DIRTY (1ULL << 55)
+// File descriptor for /proc/self/pagemap, opened for the duration of an
+// incremental leak search.  The entries of the pages
+// [lc_pagemap_start, lc_pagemap_start + lc_pagemap_n * VKI_PAGE_SIZE[
+// are buffered in lc_pagemap_buf.
+static Int   lc_pagemap_fd = -1;
+static ULong lc_pagemap_buf[512];
+static Addr  lc_pagemap_start;
+static UInt  lc_pagemap_n;
+
+// Clears the soft-dirty bits of all the pages of the process.  The kernel
+// write-protects the pages to notice the next write to each of them.
+static Bool clear_soft_dirty ( void )
+{
+   Int  fd = VG_(fd_open)("/proc/self/clear_refs", VKI_O_WRONLY, 0);
+   Bool ok;
+
+   if (fd == -1)
+      return False;
+   ok = VG_(write)(fd, "4", 1) == 1;
+   VG_(close)(fd);
+   return ok;
+}
+
+// Returns the pagemap entry of page pg, or PM_SOFT_DIRTY if unknown.
+static ULong pagemap_entry ( Int fd, Addr pg )
+{
+   Int n;
+
+   if (fd == lc_pagemap_fd && lc_pagemap_n > 0
+       && pg >= lc_pagemap_start
+       && (pg - lc_pagemap_start) / VKI_PAGE_SIZE < lc_pagemap_n)
+      return lc_pagemap_buf[(pg - lc_pagemap_start) / VKI_PAGE_SIZE];
+
+   lc_pagemap_n = 0;
+   if (VG_(lseek)(fd, (Off64T)(pg / VKI_PAGE_SIZE) * sizeof(ULong),
+                  VKI_SEEK_SET) < 0)
+      return PM_SOFT_DIRTY;
+   n = VG_(read)(fd, lc_pagemap_buf, sizeof(lc_pagemap_buf));
+   if (n < (Int)sizeof(ULong))
+      return PM_SOFT_DIRTY;
+   if (fd == lc_pagemap_fd) {
+      lc_pagemap_start = pg;
+      lc_pagemap_n = n / sizeof(ULong);
+   }
+   return lc_pagemap_buf[0];
+}
+
+// Verifies once that the kernel really tracks soft-dirty pages: without
+// CONFIG_MEM_SOFT_DIRTY, clear_refs accepts "4" but pagemap then reports
+// every page as clean.
+static Bool soft_dirty_works ( void )
+{
+   static Int works = -1;
+   static UChar probe[2 * VKI_MAX_PAGE_SIZE];
+   volatile UChar* p;
+   Int fd;
+
+   if (works != -1)
+      return works;
+
+   works = 0;
+   p = (volatile UChar*)VG_ROUNDUP((Addr)probe, VKI_PAGE_SIZE);
+   p[0] = 1;
+   fd = VG_(fd_open)("/proc/self/pagemap", VKI_O_RDONLY, 0);
+   if (fd == -1)
+      return works;
+   if (clear_soft_dirty()
+       && !(pagemap_entry(fd, (Addr)p) & PM_SOFT_DIRTY)) {
+      p[0] = 2;
+      if (pagemap_entry(fd, (Addr)p) & PM_SOFT_DIRTY)
+         works = 1;
+   }
+   VG_(close)(fd);
+   return works;
+}
+#endif
+
+// Called at the beginning of a leak search: decides if this search is
+// incremental.
+static void lc_clean_pages_start ( void )
+{
+   lc_incremental = False;
+   lc_clean_skipped_szB = 0;
+#if defined(VGO_linux)
+   if (!MC_(clo_leak_check_incremental))
+      return;
+   if (!soft_dirty_works()) {
+      static Bool warned = False;
+      if (!warned && VG_(clo_verbosity) >= 1) {
+         VG_(umsg)("Warning: --leak-check-incremental=yes ignored:"
+                   " soft-dirty page tracking not available\n");
+         warned = True;
+      }
+      return;
+   }
+   lc_pagemap_fd = VG_(fd_open)("/proc/self/pagemap", VKI_O_RDONLY, 0);
+   lc_pagemap_n = 0;
+   if (lc_pagemap_fd == -1)
+      return;
+   if (lc_clean_pages == NULL)
+      lc_clean_pages = VG_(HT_construct)("mc.lcp.1");
+   lc_incremental = True;
+#endif
+}
+
+// Called at the end of a leak search: clears the soft-dirty bits and
+// drops the clean pages that were not confirmed by this search.
+static void lc_clean_pages_end ( void )
+{
+#if defined(VGO_linux)
+   LC_CleanPage* cp;
+   Bool cleared;
+
+   if (!lc_incremental)
+      return;
+   lc_incremental = False;
+   VG_(close)(lc_pagemap_fd);
+   lc_pagemap_fd = -1;
+
+   cleared = clear_soft_dirty();
+   if (cleared)
+      lc_clean_gen++;
+   VG_(HT_ResetIter)(lc_clean_pages);
+   while ( (cp = VG_(HT_Next)(lc_clean_pages)) ) {
+      if (!cleared || cp->gen != lc_clean_gen) {
+         VG_(HT_remove_at_Iter)(lc_clean_pages);
+         VG_(free)(cp);
+      }
+   }
+#endif
+}
+
+// True if the page pg, to be scanned entirely, is known to contain no
+// word pointing in [lo, hi[.
+static Bool lc_page_is_clean ( Addr pg, Addr lo, Addr hi )
+{
+#if defined(VGO_linux)
+   LC_CleanPage* cp = VG_(HT_lookup)(lc_clean_pages, pg);
+
+   if (cp == NULL
+       || !(cp->below < lo && hi <= cp->above)
+       || !(cp->gen == lc_clean_gen || cp->gen == lc_clean_gen + 1))
+      return False;
+   if (cp->gen == lc_clean_gen) {
+      if (pagemap_entry(lc_pagemap_fd, pg) & PM_SOFT_DIRTY)
+         return False;
+      cp->gen = lc_clean_gen + 1;
+   }
+   return True;
+#else
+   return False;
+#endif
+}
+
+// Records the result of the scan of the page pg.  If clean, no word of
+// the page is in ]below, above[.
+static void lc_record_page ( Addr pg, Bool clean, Addr below, Addr above )
+{
+   LC_CleanPage* cp = VG_(HT_lookup)(lc_clean_pages, pg);
+
+   if (!clean) {
+      if (cp) {
+         VG_(HT_remove)(lc_clean_pages, pg);
+         VG_(free)(cp);
+      }
+      return;
+   }
+   if (cp == NULL) {
+      cp = VG_(malloc)("mc.lcp.2", sizeof(LC_CleanPage));
+      cp->key = pg;
+      VG_(HT_add_node)(lc_clean_pages, cp);
+   }
+   cp->below = below;
+   cp->above = above;
+   cp->gen = lc_clean_gen + 1;
+}
+
+// Returns True if the scan of [start, start+len[ can use clean pages.
+static Bool lc_range_uses_clean_pages ( Addr start, SizeT len )
+{
+   NSegment const* seg;
+
+   if (!lc_incremental || len < VKI_PAGE_SIZE)
+      return False;
+   seg = VG_(am_find_nsegment)(start);
+   return seg != NULL && seg->kind == SkAnonC && start + len - 1 <= seg->end;
+}
+
+
 static VG_MINIMAL_JMP_BUF(lc_scan_memory_jmpbuf);
 static
 void lc_scan_memory_fault_catcher ( Int sigNo, Addr addr )
@@ -1057,6 +1309,15 @@ lc_scan_memory(Addr start, SizeT len, Bool is_prior_definite,
    Addr ptr = VG_ROUNDUP(start, sizeof(Addr));
    const Addr end = VG_ROUNDDN(start+len, sizeof(Addr));
    fault_catcher_t prev_catcher;
+   // Incremental leak search: pg is the page being scanned entirely,
+   // or 0 if the current page is not scanned entirely or contains a
+   // word that could point into a chunk.  pg_below and pg_above are then
+   // the closest word values seen so far around the chunk address range.
+   const Bool use_clean_pages
+      = searched == 0 && lc_range_uses_clean_pages(start, len);
+   Addr pg = 0;
+   Addr pg_below = 0;
+   Addr pg_above = ~(Addr)0;
 
    if (VG_DEBUG_LEAKCHECK)
       VG_(printf)("scan %#lx-%#lx (%lu)\n", start, end, len);
@@ -1107,10 +1368,32 @@ lc_scan_memory(Addr start, SizeT len, Bool is_prior_definite,
       tl_assert(bad_scanned_addr < VG_ROUNDDN(start+len, sizeof(Addr)));
       ptr = bad_scanned_addr + sizeof(Addr); // Unaddressable, - skip it.
 #endif
+      pg = 0;
    }
    while (ptr < end) {
       Addr addr;
 
+      if (UNLIKELY(use_clean_pages && (ptr % VKI_PAGE_SIZE) == 0)) {
+         // Record the page just scanned, then see if the next page
+         // needs to be scanned.
+         if (pg != 0 && pg + VKI_PAGE_SIZE == ptr)
+            lc_record_page(pg, True, pg_below, pg_above);
+         pg = 0;
+         if (ptr + VKI_PAGE_SIZE <= end
+             && VG_(am_is_valid_for_client)(ptr, sizeof(Addr), VKI_PROT_READ)) {
+            if (lc_page_is_clean(ptr, lc_chunks_min_addr,
+                                 lc_chunks_max_addr)) {
+               lc_scanned_szB += VKI_PAGE_SIZE;
+               lc_clean_skipped_szB += VKI_PAGE_SIZE;
+               ptr += VKI_PAGE_SIZE;
+               continue;
+            }
+            pg = ptr;
+            pg_below = 0;
+            pg_above = ~(Addr)0;
+         }
+      }
+
       // Skip invalid chunks.
       if (UNLIKELY((ptr % SM_SIZE) == 0)) {
          if (! MC_(is_within_valid_secondary)(ptr) ) {
@@ -1133,6 +1416,18 @@ lc_scan_memory(Addr start, SizeT len, Bool is_prior_definite,
          addr = *(Addr *)ptr;
          // If we get here, the scanned word is in valid memory.  Now
          // let's see if its contents point to a chunk.
+         if (pg != 0) {
+            if (addr < lc_chunks_min_addr) {
+               if (addr > pg_below)
+                  pg_below = addr;
+            } else if (addr >= lc_chunks_max_addr) {
+               if (addr < pg_above)
+                  pg_above = addr;
+            } else {
+               lc_record_page(pg, False, 0, 0);
+               pg = 0;
+            }
+         }
          if (UNLIKELY(searched)) {
             if (addr >= searched && addr < searched + szB) {
                const DiEpoch cur_ep = VG_(current_DiEpoch)();
@@ -1167,11 +1462,20 @@ lc_scan_memory(Addr start, SizeT len, Bool is_prior_definite,
          } else {
             lc_push_if_a_chunk_ptr(addr, clique, cur_clique, is_prior_definite);
          }
-      } else if (0 && VG_DEBUG_LEAKCHECK) {
-         VG_(printf)("%#lx not valid\n", ptr);
+      } else {
+         // Invalid words are not read.  They could become valid later
+         // without being written, so their page is not recorded.
+         if (pg != 0) {
+            lc_record_page(pg, False, 0, 0);
+            pg = 0;
+         }
+         if (0 && VG_DEBUG_LEAKCHECK)
+            VG_(printf)("%#lx not valid\n", ptr);
       }
       ptr += sizeof(Addr);
    }
+   if (pg != 0 && pg + VKI_PAGE_SIZE == ptr)
+      lc_record_page(pg, True, pg_below, pg_above);
 
    VG_(set_fault_catcher)(prev_catcher);
 }
@@ -2016,6 +2320,8 @@ void MC_(detect_memory_leaks) ( ThreadId tid, LeakCheckParams* lcp)
       VG_(free)(lc_chunks);
       lc_chunks = NULL;
    }
+   lc_chunks_min_addr = 0;
+   lc_chunks_max_addr = 0;
    lc_chunks = find_active_chunks(&lc_n_chunks);
    lc_chunks_n_frees_marker = MC_(get_cmalloc_n_frees)();
    if (lc_n_chunks == 0) {
@@ -2143,6 +2449,18 @@ void MC_(detect_memory_leaks) ( ThreadId tid, LeakCheckParams* lcp)
       }
    }
 
+   // Compute the address range spanned by the chunks.  Chunks are sorted
+   // by start address, but metapool blocks can overlap, so the last chunk
+   // does not necessarily end highest.  A zero-sized block is considered
+   // to cover one byte, as in find_chunk_for.
+   lc_chunks_min_addr = lc_chunks[0]->data;
+   for (i = 0; i < lc_n_chunks; i++) {
+      MC_Chunk* ch = lc_chunks[i];
+      Addr end = ch->data + ch->szB + (ch->szB == 0 ? 1 : 0);
+      if (end > lc_chunks_max_addr)
+         lc_chunks_max_addr = end;
+   }
+
    // Initialise lc_extras.
    if (lc_extras) {
       VG_(free)(lc_extras);
@@ -2171,6 +2489,7 @@ void MC_(detect_memory_leaks) ( ThreadId tid, LeakCheckParams* lcp)
 
    // Scan the memory root-set, pushing onto the mark stack any blocks
    // pointed to.
+   lc_clean_pages_start();
    scan_memory_root_set(/*searched*/0, 0);
 
    // Scan GP registers for chunk pointers.
@@ -2185,6 +2504,9 @@ void MC_(detect_memory_leaks) ( ThreadId tid, LeakCheckParams* lcp)
       if (lc_sig_skipped_szB > 0)
          VG_(umsg)("Skipped %'lu bytes due to read errors\n",
                    lc_sig_skipped_szB);
+      if (lc_clean_skipped_szB > 0)
+         VG_(umsg)("Reused the scan of %'lu bytes in unchanged pages\n",
+                   lc_clean_skipped_szB);
       VG_(umsg)( "\n" );
    }
 
@@ -2217,6 +2539,7 @@ void MC_(detect_memory_leaks) ( ThreadId tid, LeakCheckParams* lcp)
          tl_assert(ex->state == Unreached);
       }
    }
+   lc_clean_pages_end();
 
    print_results( tid, lcp);
 
@@ -183,6 +183,29 @@ static void ocache_sarp_Clear_Origins ( Addr, UWord ); /* fwds */
 /* Do not change this. */
 #define MAX_PRIMARY_ADDRESS (Addr)((((Addr)65536) * N_PRIMARY_MAP)-1)
 
+#if VG_WORDSIZE == 8
+
+/* Addresses above MAX_PRIMARY_ADDRESS but within the usual 48-bit
+   user address space are handled by the high map, a two-level table
+   of secondary map pointers: a top table indexed by address bits
+   47:32, each entry of which points to a lazily allocated leaf
+   covering 4G (bits 31:16).  Only addresses above MAX_HIGHMAP_ADDRESS
+   fall through to the auxiliary primary map. */
+#  define N_HIGHMAP_LEAF_BITS  16
+#  define N_HIGHMAP_TOP_BITS   (48 - 16 - N_HIGHMAP_LEAF_BITS)
+
+/* Do not change these. */
+#  define N_HIGHMAP_LEAF  ( ((UWord)1) << N_HIGHMAP_LEAF_BITS)
+#  define N_HIGHMAP_TOP   ( ((UWord)1) << N_HIGHMAP_TOP_BITS)
+#  define MAX_HIGHMAP_ADDRESS (Addr)((((Addr)1) << 48)-1)
+
+#else
+
+/* The main primary map covers everything; there is no high map. */
+#  define MAX_HIGHMAP_ADDRESS MAX_PRIMARY_ADDRESS
+
+#endif
+
 
 /* --------------- Secondary maps --------------- */
 
@@ -364,8 +387,9 @@ static void update_SM_counts(SecMap* oldSM, SecMap* newSM)
 /* --------------- Primary maps --------------- */
 
 /* The main primary map.  This covers some initial part of the address
-   space, addresses 0 .. (N_PRIMARY_MAP << 16)-1.  The rest of it is
-   handled using the auxiliary primary map.  
+   space, addresses 0 .. (N_PRIMARY_MAP << 16)-1.  On 64-bit targets
+   the rest of the 48-bit address space is handled by the high map,
+   and anything above that using the auxiliary primary map.
 */
 #if ENABLE_ASSEMBLY_HELPERS && defined(PERF_FAST_LOADV) \
     && (defined(VGP_arm_linux) \
@@ -437,10 +461,10 @@ static const HChar* check_auxmap_L1_L2_sanity ( Word* n_secmaps_found )
       On a 64-bit platform:
       In the L2 table:
        all .base & 0xFFFF == 0
-       all .base > MAX_PRIMARY_ADDRESS
+       all .base > MAX_HIGHMAP_ADDRESS
       In the L1 table:
        all .base & 0xFFFF == 0
-       all (.base > MAX_PRIMARY_ADDRESS
+       all (.base > MAX_HIGHMAP_ADDRESS
             .base & 0xFFFF == 0
             and .ent points to an AuxMapEnt with the same .base)
            or
@@ -465,8 +489,8 @@ static const HChar* check_auxmap_L1_L2_sanity ( Word* n_secmaps_found )
          elems_seen++;
          if (0 != (elem->base & (Addr)0xFFFF))
             return "64-bit: nonzero .base & 0xFFFF in auxmap_L2";
-         if (elem->base <= MAX_PRIMARY_ADDRESS)
-            return "64-bit: .base <= MAX_PRIMARY_ADDRESS in auxmap_L2";
+         if (elem->base <= MAX_HIGHMAP_ADDRESS)
+            return "64-bit: .base <= MAX_HIGHMAP_ADDRESS in auxmap_L2";
          if (elem->sm == NULL)
             return "64-bit: .sm in _L2 is NULL";
          if (!is_distinguished_sm(elem->sm))
@@ -480,8 +504,8 @@ static const HChar* check_auxmap_L1_L2_sanity ( Word* n_secmaps_found )
             continue;
          if (0 != (auxmap_L1[i].base & (Addr)0xFFFF))
             return "64-bit: nonzero .base & 0xFFFF in auxmap_L1";
-         if (auxmap_L1[i].base <= MAX_PRIMARY_ADDRESS)
-            return "64-bit: .base <= MAX_PRIMARY_ADDRESS in auxmap_L1";
+         if (auxmap_L1[i].base <= MAX_HIGHMAP_ADDRESS)
+            return "64-bit: .base <= MAX_HIGHMAP_ADDRESS in auxmap_L1";
          if (auxmap_L1[i].ent == NULL)
             return "64-bit: .ent is NULL in auxmap_L1";
          if (auxmap_L1[i].ent->base != auxmap_L1[i].base)
@@ -527,7 +551,7 @@ static INLINE AuxMapEnt* maybe_find_in_auxmap ( Addr a )
    AuxMapEnt* res;
    Word       i;
 
-   tl_assert(a > MAX_PRIMARY_ADDRESS);
+   tl_assert(a > MAX_HIGHMAP_ADDRESS);
    a &= ~(Addr)0xFFFF;
 
    /* First search the front-cache, which is a self-organising
@@ -603,10 +627,99 @@ static AuxMapEnt* find_or_alloc_in_auxmap ( Addr a )
    return nyu;
 }
 
+/* --------------- High map --------------- */
+
+#if VG_WORDSIZE == 8
+
+typedef
+   struct {
+      SecMap* sm[N_HIGHMAP_LEAF];
+   }
+   HighMapLeaf;
+
+/* Top level of the high map.  Entries stay NULL until some address
+   in the 4G they cover needs a secondary map; the entries covering
+   the main primary map are never used. */
+static HighMapLeaf* highmap_top[N_HIGHMAP_TOP];
+
+/* # of leaves allocated in the high map */
+static ULong n_highmap_leaves = 0;
+
+static INLINE UWord get_highmap_top_offset ( Addr a )
+{
+   return a >> (16 + N_HIGHMAP_LEAF_BITS);
+}
+
+static INLINE UWord get_highmap_leaf_offset ( Addr a )
+{
+   return (a >> 16) & (N_HIGHMAP_LEAF - 1);
+}
+
+/* Return the slot for 'a' in the high map, or NULL if the leaf
+   covering it has not been allocated yet. */
+static INLINE SecMap** maybe_find_in_highmap ( Addr a )
+{
+   HighMapLeaf* leaf;
+   tl_assert(a > MAX_PRIMARY_ADDRESS && a <= MAX_HIGHMAP_ADDRESS);
+   leaf = highmap_top[ get_highmap_top_offset(a) ];
+   return LIKELY(leaf) ? &leaf->sm[ get_highmap_leaf_offset(a) ] : NULL;
+}
+
+static SecMap** find_or_alloc_in_highmap ( Addr a )
+{
+   HighMapLeaf* leaf;
+   UWord        i;
+
+   SecMap** res = maybe_find_in_highmap( a );
+   if (LIKELY(res))
+      return res;
+
+   /* First access to this 4G: allocate a leaf with all of it marked
+      as noaccess. */
+   leaf = VG_(am_shadow_alloc)(sizeof(HighMapLeaf));
+   if (leaf == NULL)
+      VG_(out_of_memory_NORETURN)( "memcheck:allocate high map leaf",
+                                   sizeof(HighMapLeaf) );
+   for (i = 0; i < N_HIGHMAP_LEAF; i++)
+      leaf->sm[i] = &sm_distinguished[SM_DIST_NOACCESS];
+   n_noaccess_SMs += N_HIGHMAP_LEAF;
+   n_highmap_leaves++;
+   highmap_top[ get_highmap_top_offset(a) ] = leaf;
+   return &leaf->sm[ get_highmap_leaf_offset(a) ];
+}
+
+/* Check representation invariants; if OK return NULL; else a
+   descriptive bit of text.  Also return the number of
+   non-distinguished secondary maps referred to from the high map. */
+static const HChar* check_highmap_sanity ( Word* n_secmaps_found )
+{
+   UWord i, j, n_leaves = 0;
+   *n_secmaps_found = 0;
+   for (i = 0; i < N_HIGHMAP_TOP; i++) {
+      HighMapLeaf* leaf = highmap_top[i];
+      if (leaf == NULL)
+         continue;
+      n_leaves++;
+      if (i <= get_highmap_top_offset(MAX_PRIMARY_ADDRESS))
+         return "high map leaf covers the main primary map";
+      for (j = 0; j < N_HIGHMAP_LEAF; j++) {
+         if (leaf->sm[j] == NULL)
+            return "high map leaf has a NULL secmap";
+         if (!is_distinguished_sm(leaf->sm[j]))
+            (*n_secmaps_found)++;
+      }
+   }
+   if (n_leaves != n_highmap_leaves)
+      return "disagreement on number of high map leaves";
+   return NULL; /* ok */
+}
+
+#endif
+
 /* --------------- SecMap fundamentals --------------- */
 
 // In all these, 'low' means it's definitely in the main primary map,
-// 'high' means it's definitely in the auxiliary table.
+// 'high' means it's definitely in the high map or the auxiliary table.
 
 static INLINE UWord get_primary_map_low_offset ( Addr a )
 {
@@ -625,7 +738,12 @@ static INLINE SecMap** get_secmap_low_ptr ( Addr a )
 
 static INLINE SecMap** get_secmap_high_ptr ( Addr a )
 {
-   AuxMapEnt* am = find_or_alloc_in_auxmap(a);
+   AuxMapEnt* am;
+#  if VG_WORDSIZE == 8
+   if (LIKELY(a <= MAX_HIGHMAP_ADDRESS))
+      return find_or_alloc_in_highmap(a);
+#  endif
+   am = find_or_alloc_in_auxmap(a);
    return &am->sm;
 }
 
@@ -643,6 +761,14 @@ static INLINE SecMap* get_secmap_for_reading_low ( Addr a )
 
 static INLINE SecMap* get_secmap_for_reading_high ( Addr a )
 {
+#  if VG_WORDSIZE == 8
+   /* Don't allocate a high map leaf just to read from it: a 4G range
+      without one is all noaccess. */
+   if (LIKELY(a <= MAX_HIGHMAP_ADDRESS)) {
+      SecMap** p = maybe_find_in_highmap(a);
+      return LIKELY(p) ? *p : &sm_distinguished[SM_DIST_NOACCESS];
+   }
+#  endif
    return *get_secmap_high_ptr(a);
 }
 
@@ -662,10 +788,10 @@ static INLINE SecMap* get_secmap_for_writing_high ( Addr a )
    return *p;
 }
 
-/* Produce the secmap for 'a', either from the primary map or by
-   ensuring there is an entry for it in the aux primary map.  The
-   secmap may be a distinguished one as the caller will only want to
-   be able to read it. 
+/* Produce the secmap for 'a', either from the primary map, the high
+   map or by ensuring there is an entry for it in the aux primary map.
+   The secmap may be a distinguished one as the caller will only want
+   to be able to read it.
 */
 static INLINE SecMap* get_secmap_for_reading ( Addr a )
 {
@@ -697,7 +823,14 @@ static SecMap* maybe_get_secmap_for ( Addr a )
    if (a <= MAX_PRIMARY_ADDRESS) {
       return get_secmap_for_reading_low(a);
    } else {
-      AuxMapEnt* am = maybe_find_in_auxmap(a);
+      AuxMapEnt* am;
+#     if VG_WORDSIZE == 8
+      if (LIKELY(a <= MAX_HIGHMAP_ADDRESS)) {
+         SecMap** p = maybe_find_in_highmap(a);
+         return p ? *p : NULL;
+      }
+#     endif
+      am = maybe_find_in_auxmap(a);
       return am ? am->sm : NULL;
    }
 }
@@ -1662,7 +1795,7 @@ void mc_STOREVn_slow ( Addr a, SizeT nBits, ULong vbytes, Bool bigendian )
 static void set_address_range_perms ( Addr a, SizeT lenT, UWord vabits16,
                                       UWord dsm_num )
 {
-   UWord    sm_off, sm_off16;
+   UWord    sm_off;
    UWord    vabits2 = vabits16 & 0x3;
    SizeT    lenA, lenB, len_to_next_secmap;
    Addr     aNext;
@@ -1797,14 +1930,14 @@ static void set_address_range_perms ( Addr a, SizeT lenT, UWord vabits16,
       a    += 1;
       lenA -= 1;
    }
-   // 8-aligned, 8 byte steps
-   while (True) {
-      if (lenA < 8) break;
+   // 8-aligned, 8 byte steps, done as a single fill of the vabits8
+   // array (each vabits8 byte covers 4 bytes of memory).
+   if (lenA >= 8) {
+      SizeT len8 = VG_ROUNDDN(lenA, 8);
       PROF_EVENT(MCPE_SET_ADDRESS_RANGE_PERMS_LOOP8A);
-      sm_off16 = SM_OFF_16(a);
-      sm->vabits16[sm_off16] = vabits16;
-      a    += 8;
-      lenA -= 8;
+      VG_(memset)(&sm->vabits8[SM_OFF(a)], vabits16 & 0xff, len8 >> 2);
+      a    += len8;
+      lenA -= len8;
    }
    // 1 byte steps
    while (True) {
@@ -1870,14 +2003,13 @@ static void set_address_range_perms ( Addr a, SizeT lenT, UWord vabits16,
    }
    sm = *sm_ptr;
 
-   // 8-aligned, 8 byte steps
-   while (True) {
-      if (lenB < 8) break;
+   // 8-aligned, 8 byte steps, as in part 1.
+   if (lenB >= 8) {
+      SizeT len8 = VG_ROUNDDN(lenB, 8);
       PROF_EVENT(MCPE_SET_ADDRESS_RANGE_PERMS_LOOP8B);
-      sm_off16 = SM_OFF_16(a);
-      sm->vabits16[sm_off16] = vabits16;
-      a    += 8;
-      lenB -= 8;
+      VG_(memset)(&sm->vabits8[SM_OFF(a)], vabits16 & 0xff, len8 >> 2);
+      a    += len8;
+      lenB -= len8;
    }
    // 1 byte steps
    while (True) {
@@ -2003,7 +2135,7 @@ static void make_mem_defined_if_noaccess ( Addr a, SizeT len )
 
 void MC_(copy_address_range_state) ( Addr src, Addr dst, SizeT len )
 {
-   SizeT i, j;
+   SizeT i, j, k;
    UChar vabits2, vabits8;
    Bool  aligned, nooverlap;
 
@@ -2018,29 +2150,55 @@ void MC_(copy_address_range_state) ( Addr src, Addr dst, SizeT len )
 
    if (nooverlap && aligned) {
 
-      /* Vectorised fast case, when no overlap and suitably aligned */
-      /* vector loop */
+      /* Vectorised fast case, when no overlap and suitably aligned.
+         Both ranges are 4-aligned, so the vabits8 bytes of src can be
+         copied as they are, a sec-map piece at a time. */
       i = 0;
       while (len >= 4) {
-         vabits8 = get_vabits8_for_aligned_word32( src+i );
-         set_vabits8_for_aligned_word32( dst+i, vabits8 );
-         if (LIKELY(VA_BITS8_DEFINED == vabits8 
-                            || VA_BITS8_UNDEFINED == vabits8 
-                            || VA_BITS8_NOACCESS == vabits8)) {
-            /* do nothing */
+         SecMap* src_sm = get_secmap_for_reading( src+i );
+         SizeT   n      = len;
+         if (n > start_of_this_sm(src+i) + SM_SIZE - (src+i))
+            n = start_of_this_sm(src+i) + SM_SIZE - (src+i);
+         if (n > start_of_this_sm(dst+i) + SM_SIZE - (dst+i))
+            n = start_of_this_sm(dst+i) + SM_SIZE - (dst+i);
+         n = VG_ROUNDDN(n, 4);
+
+         if (n == SM_SIZE && is_distinguished_sm(src_sm)) {
+            /* A whole distinguished sec-map: share it rather than
+               copying its content. */
+            SecMap** dst_sm_ptr = get_secmap_ptr( dst+i );
+            if (*dst_sm_ptr != src_sm) {
+               if (!is_distinguished_sm(*dst_sm_ptr)) {
+                  SysRes sres = VG_(am_munmap_valgrind)((Addr)*dst_sm_ptr,
+                                                        sizeof(SecMap));
+                  tl_assert2(! sr_isError(sres),
+                             "SecMap valgrind munmap failure\n");
+               }
+               update_SM_counts(*dst_sm_ptr, src_sm);
+               *dst_sm_ptr = src_sm;
+            }
          } else {
-            /* have to copy secondary map info */
-            if (VA_BITS2_PARTDEFINED == get_vabits2( src+i+0 ))
-               set_sec_vbits8( dst+i+0, get_sec_vbits8( src+i+0 ) );
-            if (VA_BITS2_PARTDEFINED == get_vabits2( src+i+1 ))
-               set_sec_vbits8( dst+i+1, get_sec_vbits8( src+i+1 ) );
-            if (VA_BITS2_PARTDEFINED == get_vabits2( src+i+2 ))
-               set_sec_vbits8( dst+i+2, get_sec_vbits8( src+i+2 ) );
-            if (VA_BITS2_PARTDEFINED == get_vabits2( src+i+3 ))
-               set_sec_vbits8( dst+i+3, get_sec_vbits8( src+i+3 ) );
+            SecMap* dst_sm = get_secmap_for_writing( dst+i );
+            const UChar* src8 = &src_sm->vabits8[SM_OFF(src+i)];
+            VG_(memcpy)( &dst_sm->vabits8[SM_OFF(dst+i)], src8, n >> 2 );
+            /* Copy the secondary V bits of the partially defined
+               bytes, if any.  There are none in a distinguished
+               sec-map. */
+            if (!is_distinguished_sm(src_sm)) {
+               for (j = 0; j < n >> 2; j++) {
+                  vabits8 = src8[j];
+                  if (LIKELY(((vabits8 & (vabits8 >> 1)) & 0x55) == 0))
+                     continue; /* no VA_BITS2_PARTDEFINED in here */
+                  for (k = 0; k < 4; k++) {
+                     Addr s4 = src+i+4*j+k;
+                     if (VA_BITS2_PARTDEFINED == get_vabits2( s4 ))
+                        set_sec_vbits8( dst+i+4*j+k, get_sec_vbits8( s4 ) );
+                  }
+               }
+            }
          }
-         i += 4;
-         len -= 4;
+         i += n;
+         len -= n;
       }
       /* fixup loop */
       while (len >= 1) {
@@ -2158,8 +2316,10 @@ void MC_(copy_address_range_state) ( Addr src, Addr dst, SizeT len )
 
    Memory is shadowed using a two level cache structure (ocacheL1 and
    ocacheL2).  Memory references are first directed to ocacheL1.  This
-   is a traditional 2-way set associative cache with 32-byte lines and
-   approximate LRU replacement within each set.
+   is a traditional set associative cache with 32-byte lines and
+   approximate LRU replacement within each set.  The number of sets and
+   ways is given by --origin-cache-sets and --origin-cache-ways; by
+   default it is 2-way with 2^20 sets.
 
    A naive implementation would require storing one 32 bit otag for
    each byte of memory covered, a 4:1 space overhead.  Instead, there
@@ -2177,8 +2337,10 @@ void MC_(copy_address_range_state) ( Addr src, Addr dst, SizeT len )
    zeroes to be installed.  However, ejecting a line containing
    nonzeroes risks losing origin information permanently.  In order to
    prevent such lossage, ejected nonzero lines are placed in a
-   secondary cache (ocacheL2), which is an OSet (AVL tree) of cache
-   lines.  This can grow arbitrarily large, and so should ensure that
+   secondary cache (ocacheL2), which is a hash table of cache lines
+   keyed by tag.  For the same reason, on a miss the L1 prefers to
+   eject a line with no origins over a more recently used useful one.
+   The L2 can grow arbitrarily large, and so should ensure that
    Memcheck runs out of memory in preference to losing useful origin
    info due to cache size limitations.
 
@@ -2401,6 +2563,7 @@ static UWord stats_ocacheL1_found_at_N     = 0;
 static UWord stats_ocacheL1_misses         = 0;
 static UWord stats_ocacheL1_lossage        = 0;
 static UWord stats_ocacheL1_movefwds       = 0;
+static UWord stats_ocacheL1_spared         = 0;
 
 static UWord stats__ocacheL2_refs          = 0;
 static UWord stats__ocacheL2_misses        = 0;
@@ -2418,12 +2581,8 @@ static INLINE Bool is_valid_oc_tag ( Addr tag ) {
    return 0 == (tag & ((1 << OC_BITS_PER_LINE) - 1));
 }
 
-#define OC_LINES_PER_SET 2
-
-#define OC_N_SET_BITS    20
-#define OC_N_SETS        (1 << OC_N_SET_BITS)
-
-/* These settings give:
+/* The L1 geometry is set at startup by --origin-cache-sets and
+   --origin-cache-ways.  The defaults give:
    64 bit host: ocache:  100,663,296 sizeB    67,108,864 useful
    32 bit host: ocache:   92,274,688 sizeB    67,108,864 useful
 */
@@ -2456,49 +2615,56 @@ static UChar classify_OCacheLine ( OCacheLine* line )
    return 'z'; /* ZERO - no useful info */
 }
 
-typedef
-   struct {
-      OCacheLine line[OC_LINES_PER_SET];
-   }
-   OCacheSet;
+/* The L1 cache proper: ocacheL1_n_sets sets of (1 << ocacheL1_ways_bits)
+   lines each, stored set after set. */
+static OCacheLine* ocacheL1 = NULL;
+static UWord       ocacheL1_set_mask  = 0;
+static UWord       ocacheL1_ways_bits = 0;
+static UWord       ocacheL1_event_ctr = 0;
 
-typedef
-   struct {
-      OCacheSet set[OC_N_SETS];
-   }
-   OCache;
+#define OC_N_SETS        ((UWord)MC_(clo_origin_cache_sets))
+#define OC_LINES_PER_SET ((UWord)MC_(clo_origin_cache_ways))
 
-static OCache* ocacheL1 = NULL;
-static UWord   ocacheL1_event_ctr = 0;
+static INLINE UWord oc_set_no ( Addr a ) {
+   return (a >> OC_BITS_PER_LINE) & ocacheL1_set_mask;
+}
+static INLINE OCacheLine* oc_set ( UWord setno ) {
+   return &ocacheL1[setno << ocacheL1_ways_bits];
+}
 
 static void init_ocacheL2 ( void ); /* fwds */
 static void init_OCache ( void )
 {
-   UWord line, set;
+   UWord i, n_lines;
    tl_assert(MC_(clo_mc_level) >= 3);
    tl_assert(ocacheL1 == NULL);
-   ocacheL1 = VG_(am_shadow_alloc)(sizeof(OCache));
+   tl_assert(OC_N_SETS > 0 && 0 == (OC_N_SETS & (OC_N_SETS - 1)));
+   tl_assert(OC_LINES_PER_SET >= 2
+             && 0 == (OC_LINES_PER_SET & (OC_LINES_PER_SET - 1)));
+   ocacheL1_set_mask = OC_N_SETS - 1;
+   while ((1UL << ocacheL1_ways_bits) < OC_LINES_PER_SET)
+      ocacheL1_ways_bits++;
+   n_lines = OC_N_SETS * OC_LINES_PER_SET;
+   ocacheL1 = VG_(am_shadow_alloc)(n_lines * sizeof(OCacheLine));
    if (ocacheL1 == NULL) {
       VG_(out_of_memory_NORETURN)( "memcheck:allocating ocacheL1", 
-                                   sizeof(OCache) );
+                                   n_lines * sizeof(OCacheLine) );
    }
    tl_assert(ocacheL1 != NULL);
-   for (set = 0; set < OC_N_SETS; set++) {
-      for (line = 0; line < OC_LINES_PER_SET; line++) {
-         ocacheL1->set[set].line[line].tag = 1/*invalid*/;
-      }
+   for (i = 0; i < n_lines; i++) {
+      ocacheL1[i].tag = 1/*invalid*/;
    }
    init_ocacheL2();
 }
 
-static void moveLineForwards ( OCacheSet* set, UWord lineno )
+static void moveLineForwards ( OCacheLine* set, UWord lineno )
 {
    OCacheLine tmp;
    stats_ocacheL1_movefwds++;
    tl_assert(lineno > 0 && lineno < OC_LINES_PER_SET);
-   tmp = set->line[lineno-1];
-   set->line[lineno-1] = set->line[lineno];
-   set->line[lineno] = tmp;
+   tmp = set[lineno-1];
+   set[lineno-1] = set[lineno];
+   set[lineno] = tmp;
 }
 
 static void zeroise_OCacheLine ( OCacheLine* line, Addr tag ) {
@@ -2513,65 +2679,66 @@ static void zeroise_OCacheLine ( OCacheLine* line, Addr tag ) {
 //////////////////////////////////////////////////////////////
 //// OCache backing store
 
-static OSet* ocacheL2 = NULL;
+/* A hash table of lines keyed by tag.  DO NOT CHANGE THE LAYOUT of
+   OCacheL2Node: VgHashTable needs the chain pointer followed by the
+   key, and OCacheLine starts with its tag. */
+typedef
+   struct _OCacheL2Node {
+      struct _OCacheL2Node* next;
+      OCacheLine            line;
+   }
+   OCacheL2Node;
 
-static void* ocacheL2_malloc ( const HChar* cc, SizeT szB ) {
-   return VG_(malloc)(cc, szB);
-}
-static void ocacheL2_free ( void* v ) {
-   VG_(free)( v );
-}
+static VgHashTable* ocacheL2 = NULL;
 
-/* Stats: # nodes currently in tree */
+/* Stats: # nodes currently in the table */
 static UWord stats__ocacheL2_n_nodes = 0;
 
 static void init_ocacheL2 ( void )
 {
    tl_assert(!ocacheL2);
-   tl_assert(sizeof(Word) == sizeof(Addr)); /* since OCacheLine.tag :: Addr */
+   tl_assert(sizeof(UWord) == sizeof(Addr)); /* since OCacheLine.tag :: Addr */
    tl_assert(0 == offsetof(OCacheLine,tag));
-   ocacheL2 
-      = VG_(OSetGen_Create)( offsetof(OCacheLine,tag), 
-                             NULL, /* fast cmp */
-                             ocacheL2_malloc, "mc.ioL2", ocacheL2_free);
+   tl_assert(offsetof(OCacheL2Node,line) == offsetof(VgHashNode,key));
+   ocacheL2 = VG_(HT_construct)( "mc.ioL2" );
    stats__ocacheL2_n_nodes = 0;
 }
 
-/* Find line with the given tag in the tree, or NULL if not found. */
+/* Find line with the given tag in the table, or NULL if not found. */
 static OCacheLine* ocacheL2_find_tag ( Addr tag )
 {
-   OCacheLine* line;
+   OCacheL2Node* node;
    tl_assert(is_valid_oc_tag(tag));
    stats__ocacheL2_refs++;
-   line = VG_(OSetGen_Lookup)( ocacheL2, &tag );
-   return line;
+   node = VG_(HT_lookup)( ocacheL2, tag );
+   return node ? &node->line : NULL;
 }
 
-/* Delete the line with the given tag from the tree, if it is present, and
-   free up the associated memory. */
+/* Delete the line with the given tag from the table, if it is present,
+   and free up the associated memory. */
 static void ocacheL2_del_tag ( Addr tag )
 {
-   OCacheLine* line;
+   OCacheL2Node* node;
    tl_assert(is_valid_oc_tag(tag));
    stats__ocacheL2_refs++;
-   line = VG_(OSetGen_Remove)( ocacheL2, &tag );
-   if (line) {
-      VG_(OSetGen_FreeNode)(ocacheL2, line);
+   node = VG_(HT_remove)( ocacheL2, tag );
+   if (node) {
+      VG_(free)(node);
       tl_assert(stats__ocacheL2_n_nodes > 0);
       stats__ocacheL2_n_nodes--;
    }
 }
 
-/* Add a copy of the given line to the tree.  It must not already be
+/* Add a copy of the given line to the table.  It must not already be
    present. */
 static void ocacheL2_add_line ( OCacheLine* line )
 {
-   OCacheLine* copy;
+   OCacheL2Node* copy;
    tl_assert(is_valid_oc_tag(line->tag));
-   copy = VG_(OSetGen_AllocNode)( ocacheL2, sizeof(OCacheLine) );
-   *copy = *line;
+   copy = VG_(malloc)( "mc.ioL2.1", sizeof(OCacheL2Node) );
+   copy->line = *line;
    stats__ocacheL2_refs++;
-   VG_(OSetGen_Insert)( ocacheL2, copy );
+   VG_(HT_add_node)( ocacheL2, copy );
    stats__ocacheL2_n_nodes++;
    if (stats__ocacheL2_n_nodes > stats__ocacheL2_n_nodes_max)
       stats__ocacheL2_n_nodes_max = stats__ocacheL2_n_nodes;
@@ -2580,20 +2747,42 @@ static void ocacheL2_add_line ( OCacheLine* line )
 ////
 //////////////////////////////////////////////////////////////
 
+/* Choose the line to eject from a full set on a miss.  Lines holding
+   no origins (empty or all-zero) are dropped in preference to useful
+   ones, since ejecting them never needs an L2 insertion; among lines
+   of the same kind, the one nearest the back of the set goes. */
+static UWord choose_OCacheLine_victim ( OCacheLine* set )
+{
+   UWord line, zero = OC_LINES_PER_SET;
+   for (line = OC_LINES_PER_SET - 1; line > 0; line--) {
+      UChar c = classify_OCacheLine(&set[line]);
+      if (c == 'e')
+         return line;
+      if (c == 'z' && zero == OC_LINES_PER_SET)
+         zero = line;
+   }
+   if (zero < OC_LINES_PER_SET) {
+      stats_ocacheL1_spared++;
+      return zero;
+   }
+   return OC_LINES_PER_SET - 1;
+}
+
 __attribute__((noinline))
 static OCacheLine* find_OCacheLine_SLOW ( Addr a )
 {
    OCacheLine *victim, *inL2;
    UChar c;
-   UWord line;
-   UWord setno   = (a >> OC_BITS_PER_LINE) & (OC_N_SETS - 1);
+   UWord line, i;
+   UWord setno   = oc_set_no(a);
    UWord tagmask = ~((1 << OC_BITS_PER_LINE) - 1);
    UWord tag     = a & tagmask;
+   OCacheLine* set = oc_set(setno);
    tl_assert(setno >= 0 && setno < OC_N_SETS);
 
    /* we already tried line == 0; skip therefore. */
    for (line = 1; line < OC_LINES_PER_SET; line++) {
-      if (ocacheL1->set[setno].line[line].tag == tag) {
+      if (set[line].tag == tag) {
          if (line == 1) {
             stats_ocacheL1_found_at_1++;
          } else {
@@ -2601,22 +2790,22 @@ static OCacheLine* find_OCacheLine_SLOW ( Addr a )
          }
          if (UNLIKELY(0 == (ocacheL1_event_ctr++ 
                             & ((1<<OC_MOVE_FORWARDS_EVERY_BITS)-1)))) {
-            moveLineForwards( &ocacheL1->set[setno], line );
+            moveLineForwards( set, line );
             line--;
          }
-         return &ocacheL1->set[setno].line[line];
+         return &set[line];
       }
    }
 
-   /* A miss.  Use the last slot.  Implicitly this means we're
-      ejecting the line in the last slot. */
+   /* A miss.  Choose a slot to reuse.  Implicitly this means we're
+      ejecting the line in that slot. */
    stats_ocacheL1_misses++;
    tl_assert(line == OC_LINES_PER_SET);
-   line--;
+   line = choose_OCacheLine_victim( set );
    tl_assert(line > 0);
 
    /* First, move the to-be-ejected line to the L2 cache. */
-   victim = &ocacheL1->set[setno].line[line];
+   victim = &set[line];
    c = classify_OCacheLine(victim);
    switch (c) {
       case 'e':
@@ -2645,32 +2834,37 @@ static OCacheLine* find_OCacheLine_SLOW ( Addr a )
          tl_assert(0);
    }
 
-   /* Now we must reload the L1 cache from the backing tree, if
+   /* Now we must reload the L1 cache from the backing table, if
       possible. */
    tl_assert(tag != victim->tag); /* stay sane */
    inL2 = ocacheL2_find_tag( tag );
    if (inL2) {
       /* We're in luck.  It's in the L2. */
-      ocacheL1->set[setno].line[line] = *inL2;
+      *victim = *inL2;
    } else {
       /* Missed at both levels of the cache hierarchy.  We have to
          declare it as full of zeroes (unknown origins). */
       stats__ocacheL2_misses++;
-      zeroise_OCacheLine( &ocacheL1->set[setno].line[line], tag );
+      zeroise_OCacheLine( victim, tag );
    }
 
-   /* Move it one forwards */
-   moveLineForwards( &ocacheL1->set[setno], line );
-   line--;
+   /* Move it to the front; the lines before it each move one back. */
+   if (line > 0) {
+      OCacheLine tmp = *victim;
+      for (i = line; i > 0; i--)
+         set[i] = set[i-1];
+      set[0] = tmp;
+   }
 
-   return &ocacheL1->set[setno].line[line];
+   return &set[0];
 }
 
 static INLINE OCacheLine* find_OCacheLine ( Addr a )
 {
-   UWord setno   = (a >> OC_BITS_PER_LINE) & (OC_N_SETS - 1);
+   UWord setno   = oc_set_no(a);
    UWord tagmask = ~((1 << OC_BITS_PER_LINE) - 1);
    UWord tag     = a & tagmask;
+   OCacheLine* set = oc_set(setno);
 
    stats_ocacheL1_find++;
 
@@ -2679,8 +2873,8 @@ static INLINE OCacheLine* find_OCacheLine ( Addr a )
       tl_assert(0 == (tag & (4 * OC_W32S_PER_LINE - 1)));
    }
 
-   if (LIKELY(ocacheL1->set[setno].line[0].tag == tag)) {
-      return &ocacheL1->set[setno].line[0];
+   if (LIKELY(set[0].tag == tag)) {
+      return &set[0];
    }
 
    return find_OCacheLine_SLOW( a );
@@ -4140,6 +4334,81 @@ Bool MC_(check_mem_is_noaccess) ( Addr a, SizeT len, Addr* bad_addr )
    return True;
 }
 
+/* Returns the length of the longest prefix of [a, a+len), made of
+   whole 4-byte granules, in which every byte is defined (if
+   defined_only) or addressable.  a must be 4-aligned.  The vabits8
+   bytes are examined a sec-map piece at a time, 8 of them at once
+   where possible, and distinguished sec-maps are accepted or rejected
+   as a whole.  The granule following the prefix, if any, contains a
+   byte that is not defined (resp. not addressable). */
+static SizeT vabits8_ok_prefix ( Addr a, SizeT len, Bool defined_only )
+{
+   const ULong ones55 = 0x5555555555555555ULL;
+   SizeT done = 0;
+
+   tl_assert(VG_IS_4_ALIGNED(a));
+   while (len - done >= 4) {
+      Addr    cur = a + done;
+      SecMap* sm  = get_secmap_for_reading(cur);
+      SizeT   n   = start_of_this_sm(cur) + SM_SIZE - cur;
+      SizeT   nb, j = 0;
+      const UChar* p8;
+
+      if (n > len - done)
+         n = len - done;
+      nb = n >> 2;
+      p8 = &sm->vabits8[SM_OFF(cur)];
+      if (is_distinguished_sm(sm)) {
+         /* All bytes have the same V+A bits. */
+         if (sm == &sm_distinguished[SM_DIST_DEFINED]
+             || (!defined_only && sm == &sm_distinguished[SM_DIST_UNDEFINED]))
+            j = nb;
+      } else {
+         while (j < nb && !VG_IS_8_ALIGNED(p8 + j)
+                && (defined_only ? p8[j] == VA_BITS8_DEFINED
+                                 : ((p8[j] | (p8[j] >> 1)) & 0x55) == 0x55))
+            j++;
+         if (j < nb && VG_IS_8_ALIGNED(p8 + j)) {
+            for (; j + 8 <= nb; j += 8) {
+               ULong w = *(const ULong*)(Addr)(p8 + j);
+               if (defined_only ? w != 0xAAAAAAAAAAAAAAAAULL
+                                : ((w | (w >> 1)) & ones55) != ones55)
+                  break;
+            }
+         }
+         while (j < nb
+                && (defined_only ? p8[j] == VA_BITS8_DEFINED
+                                 : ((p8[j] | (p8[j] >> 1)) & 0x55) == 0x55))
+            j++;
+      }
+      done += j << 2;
+      if (j < nb)
+         break;
+   }
+   return done;
+}
+
+/* Returns the length of a prefix of [a, a+len) in which every byte
+   is addressable and, if undefined values are tracked, defined.  This
+   may be shorter than the longest such prefix by up to 3 bytes.  Used
+   by the string function replacements to find out which bytes they
+   can read a word at a time without hiding or causing any error. */
+static SizeT mem_ok_prefix ( Addr a, SizeT len )
+{
+   Bool  defined_only = MC_(clo_mc_level) >= 2;
+   SizeT i = 0;
+   while (i < len && !VG_IS_4_ALIGNED(a + i)) {
+      UWord vabits2 = get_vabits2(a + i);
+      if (vabits2 != VA_BITS2_DEFINED
+          && (defined_only || vabits2 == VA_BITS2_NOACCESS))
+         return i;
+      i++;
+   }
+   if (i == len)
+      return i;
+   return i + vabits8_ok_prefix(a + i, len - i, defined_only);
+}
+
 static Bool is_mem_addressable ( Addr a, SizeT len, 
                                  /*OUT*/Addr* bad_addr )
 {
@@ -4147,6 +4416,13 @@ static Bool is_mem_addressable ( Addr a, SizeT len,
    UWord vabits2;
 
    PROF_EVENT(MCPE_IS_MEM_ADDRESSABLE);
+   /* Skip in bulk over the addressable part of the range; the byte loop
+      below then only has to find the exact bad byte, if any. */
+   if (VG_IS_4_ALIGNED(a)) {
+      SizeT ok = vabits8_ok_prefix(a, len, False/*defined_only*/);
+      a   += ok;
+      len -= ok;
+   }
    for (i = 0; i < len; i++) {
       PROF_EVENT(MCPE_IS_MEM_ADDRESSABLE_LOOP);
       vabits2 = get_vabits2(a);
@@ -4171,6 +4447,13 @@ static MC_ReadResult is_mem_defined ( Addr a, SizeT len,
 
    if (otag)     *otag = 0;
    if (bad_addr) *bad_addr = 0;
+   /* Skip in bulk over the part of the range that cannot give an
+      error, as in is_mem_addressable. */
+   if (VG_IS_4_ALIGNED(a)) {
+      SizeT ok = vabits8_ok_prefix(a, len, MC_(clo_mc_level) >= 2);
+      a   += ok;
+      len -= ok;
+   }
    for (i = 0; i < len; i++) {
       PROF_EVENT(MCPE_IS_MEM_DEFINED_LOOP);
       vabits2 = get_vabits2(a);
@@ -5891,9 +6174,21 @@ static Bool mc_expensive_sanity_check ( void )
       return False;
    }
 
+#  if VG_WORDSIZE == 8
+   {
+      Word n_highmap_secmaps = 0;
+      errmsg = check_highmap_sanity( &n_highmap_secmaps );
+      if (errmsg) {
+         VG_(printf)("memcheck expensive sanity, high map:\n\t%s", errmsg);
+         return False;
+      }
+      n_secmaps_found += n_highmap_secmaps;
+   }
+#  endif
+
    /* n_secmaps_found is now the number referred to by the auxiliary
-      primary map.  Now add on the ones referred to by the main
-      primary map. */
+      primary map and the high map.  Now add on the ones referred to
+      by the main primary map. */
    for (i = 0; i < N_PRIMARY_MAP; i++) {
       if (primary_map[i] == NULL) {
          bad = True;
@@ -5943,12 +6238,16 @@ UInt          MC_(clo_leak_check_heuristics)  =   H2S(LchStdString)
                                                 | H2S( LchLength64)
                                                 | H2S( LchNewArray)
                                                 | H2S( LchMultipleInheritance);
+Bool          MC_(clo_leak_check_incremental) = False;
+Int           MC_(clo_origin_cache_sets)      = 1 << 20;
+Int           MC_(clo_origin_cache_ways)      = 2;
 Bool          MC_(clo_xtree_leak)             = False;
 const HChar*  MC_(clo_xtree_leak_file) = "xtleak.kcg.%p";
 Bool          MC_(clo_workaround_gcc296_bugs) = False;
 Int           MC_(clo_malloc_fill)            = -1;
 Int           MC_(clo_free_fill)              = -1;
 KeepStacktraces MC_(clo_keep_stacktraces)     = KS_alloc_and_free;
+Int           MC_(clo_alloc_site_sampling)    = 100;
 Int           MC_(clo_mc_level)               = 2;
 Bool          MC_(clo_show_mismatched_frees)  = True;
 
@@ -6015,6 +6314,8 @@ static Bool mc_process_cmd_line_options(const HChar* arg)
    else if VG_USET_CLOM(cloPD, arg, "--leak-check-heuristics",
                         MC_(parse_leak_heuristics_tokens),
                         MC_(clo_leak_check_heuristics)) {}
+   else if VG_BOOL_CLOM(cloPD, arg, "--leak-check-incremental",
+                        MC_(clo_leak_check_incremental)) {}
    else if (VG_BOOL_CLOM(cloPD, arg, "--show-reachable", tmp_show)) {
       if (tmp_show) {
          MC_(clo_show_leak_kinds) = MC_(all_Reachedness)();
@@ -6039,6 +6340,19 @@ static Bool mc_process_cmd_line_options(const HChar* arg)
                         MC_(clo_freelist_big_blocks),
                         0, 10*1000*1000*1000LL) {}
 
+   else if VG_BINT_CLO(arg, "--origin-cache-sets",
+                       MC_(clo_origin_cache_sets), 16, 1 << 24) {
+      if (0 != (MC_(clo_origin_cache_sets)
+                & (MC_(clo_origin_cache_sets) - 1)))
+         VG_(fmsg_bad_option)(arg, "must be a power of 2.\n");
+   }
+   else if VG_BINT_CLO(arg, "--origin-cache-ways",
+                       MC_(clo_origin_cache_ways), 2, 16) {
+      if (0 != (MC_(clo_origin_cache_ways)
+                & (MC_(clo_origin_cache_ways) - 1)))
+         VG_(fmsg_bad_option)(arg, "must be 2, 4, 8 or 16.\n");
+   }
+
    else if VG_XACT_CLOM(cloPD, arg, "--leak-check=no",
                        MC_(clo_leak_check), LC_Off) {}
    else if VG_XACT_CLOM(cloPD, arg, "--leak-check=summary",
@@ -6141,6 +6455,9 @@ static Bool mc_process_cmd_line_options(const HChar* arg)
    else if VG_XACT_CLO(arg, "--keep-stacktraces=none",
                        MC_(clo_keep_stacktraces), KS_none) {}
 
+   else if VG_BINT_CLO(arg, "--alloc-site-sampling",
+                       MC_(clo_alloc_site_sampling), 0, 100) {}
+
    else if VG_BOOL_CLOM(cloPD, arg, "--show-mismatched-frees",
                         MC_(clo_show_mismatched_frees)) {}
 
@@ -6183,6 +6500,8 @@ static void mc_print_usage(void)
 "        improving leak search false positive [all]\n"
 "        where heur is one of:\n"
 "          stdstring length64 newarray multipleinheritance all none\n"
+"    --leak-check-incremental=no|yes  don't rescan pages unchanged since the\n"
+"        previous leak search (Linux, needs soft-dirty page tracking) [no]\n"
 "    --show-reachable=yes             same as --show-leak-kinds=all\n"
 "    --show-reachable=no --show-possibly-lost=yes\n"
 "                                     same as --show-leak-kinds=definite,possible\n"
@@ -6192,6 +6511,9 @@ static void mc_print_usage(void)
 "    --xtree-leak-file=<file>         xtree leak report file [xtleak.kcg.%%p]\n"
 "    --undef-value-errors=no|yes      check for undefined value errors [yes]\n"
 "    --track-origins=no|yes           show origins of undefined values? [no]\n"
+"    --origin-cache-sets=<number>     sets in the origin cache, a power of 2\n"
+"                                     [1048576]\n"
+"    --origin-cache-ways=2|4|8|16     lines per origin cache set [2]\n"
 "    --partial-loads-ok=no|yes        too hard to explain here; see manual [yes]\n"
 "    --expensive-definedness-checks=no|auto|yes\n"
 "                                     Use extra-precise definedness tracking [auto]\n"
@@ -6206,6 +6528,8 @@ static void mc_print_usage(void)
 "    --free-fill=<hexnumber>          fill free'd areas with given value\n"
 "    --keep-stacktraces=alloc|free|alloc-and-free|alloc-then-free|none\n"
 "        stack trace(s) to keep for malloc'd/free'd areas       [alloc-and-free]\n"
+"    --alloc-site-sampling=<0..100>   percentage of allocation sites whose\n"
+"                                     blocks are fully checked [100]\n"
 "    --show-mismatched-frees=no|yes   show frees that don't match the allocator? [yes]\n"
    );
 }
@@ -7089,6 +7413,10 @@ static Bool mc_handle_client_request ( ThreadId tid, UWord* arg, UWord* ret )
          return True;
       }
 
+      case _VG_USERREQ__MEMCHECK_GET_OK_PREFIX:
+         *ret = mem_ok_prefix( (Addr)arg[1], (SizeT)arg[2] );
+         return True;
+
       case VG_USERREQ__CREATE_MEMPOOL: {
          Addr pool      = (Addr)arg[1];
          UInt rzB       =       arg[2];
@@ -7872,6 +8200,16 @@ static void mc_post_clo_init ( void )
       // Activate full xtree memory profiling.
       VG_(XTMemory_Full_init)(VG_(XT_filter_1top_and_maybe_below_main));
    }
+
+   if (MC_(clo_alloc_site_sampling) < 100
+       && (MC_(clo_keep_stacktraces) == KS_none
+           || MC_(clo_keep_stacktraces) == KS_free)) {
+      VG_(fmsg_bad_option)("--keep-stacktraces",
+                           "To use --alloc-site-sampling, you must"
+                           " keep at least the alloc stacktrace\n");
+      // Not fatal at this point: fall back to checking all the sites.
+      MC_(clo_alloc_site_sampling) = 100;
+   }
    
 }
 
@@ -7885,15 +8223,36 @@ static void print_SM_info(const HChar* type, Int n_SMs)
       n_SMs * sizeof(SecMap) / (1024 * 1024UL) );
 }
 
+/* n as a percentage of total, in tenths of a percent. */
+static UWord pct_x10 ( UWord n, UWord total )
+{
+   return total == 0 ? 0 : (UWord)((1000ULL * n) / total);
+}
+
 static void mc_print_stats (void)
 {
    SizeT max_secVBit_szB, max_SMs_szB, max_shmem_szB;
 
    VG_(message)(Vg_DebugMsg, " memcheck: freelist: vol %lld length %lld\n",
                 VG_(free_queue_volume), VG_(free_queue_length));
+   VG_(message)(Vg_DebugMsg, " memcheck: freelist: %lld bytes of pages"
+                " released to the OS\n",
+                MC_(free_queue_discarded_volume));
+   if (MC_(clo_alloc_site_sampling) < 100)
+      VG_(message)(Vg_DebugMsg,
+                   " memcheck: alloc-site sampling: %llu blocks checked,"
+                   " %llu unchecked\n",
+                   MC_(n_sampled_blocks), MC_(n_unsampled_blocks));
    VG_(message)(Vg_DebugMsg,
       " memcheck: sanity checks: %d cheap, %d expensive\n",
       n_sanity_cheap, n_sanity_expensive );
+#  if VG_WORDSIZE == 8
+   VG_(message)(Vg_DebugMsg,
+      " memcheck: high map: %llu leaves (%lluk, %lluM) in use\n",
+      n_highmap_leaves,
+      n_highmap_leaves * sizeof(HighMapLeaf) / 1024,
+      n_highmap_leaves * sizeof(HighMapLeaf) / (1024 * 1024) );
+#  endif
    VG_(message)(Vg_DebugMsg,
       " memcheck: auxmaps: %llu auxmap entries (%lluk, %lluM) in use\n",
       n_auxmap_L2_nodes, 
@@ -7928,6 +8287,10 @@ static void mc_print_stats (void)
    max_secVBit_szB = max_secVBit_nodes * 
          (3*sizeof(Word) + VG_ROUNDUP(sizeof(SecVBitNode), sizeof(void*)));
    max_shmem_szB   = sizeof(primary_map) + max_SMs_szB + max_secVBit_szB;
+#  if VG_WORDSIZE == 8
+   max_shmem_szB  += sizeof(highmap_top)
+                     + n_highmap_leaves * sizeof(HighMapLeaf);
+#  endif
 
    VG_(message)(Vg_DebugMsg,
       " memcheck: max sec V bit nodes:    %d (%luk, %luM)\n",
@@ -7958,9 +8321,20 @@ static void mc_print_stats (void)
                    stats_ocacheL1_found_at_N,
                    stats_ocacheL1_movefwds );
       VG_(message)(Vg_DebugMsg,
-                   " ocacheL1: %'12lu sizeB  %'12d useful\n",
-                   (SizeT)sizeof(OCache),
+                   " ocacheL1: %'12lu sizeB  %'12lu useful\n",
+                   OC_N_SETS * OC_LINES_PER_SET * sizeof(OCacheLine),
                    4 * OC_W32S_PER_LINE * OC_LINES_PER_SET * OC_N_SETS );
+      VG_(message)(Vg_DebugMsg,
+                   " ocacheL1: %lu sets x %lu ways, %'lu spared victims\n",
+                   OC_N_SETS, OC_LINES_PER_SET, stats_ocacheL1_spared );
+      VG_(message)(Vg_DebugMsg,
+                   " ocacheL1: hit rate %lu.%lu%%, spill rate %lu.%lu%%\n",
+                   pct_x10(stats_ocacheL1_find - stats_ocacheL1_misses,
+                           stats_ocacheL1_find) / 10,
+                   pct_x10(stats_ocacheL1_find - stats_ocacheL1_misses,
+                           stats_ocacheL1_find) % 10,
+                   pct_x10(stats_ocacheL1_lossage, stats_ocacheL1_misses) / 10,
+                   pct_x10(stats_ocacheL1_lossage, stats_ocacheL1_misses) % 10);
       VG_(message)(Vg_DebugMsg,
                    " ocacheL2: %'12lu refs   %'12lu misses\n",
                    stats__ocacheL2_refs, 
@@ -28,6 +28,7 @@
 */
 
 #include "pub_tool_basics.h"
+#include "pub_tool_aspacemgr.h"
 #include "pub_tool_execontext.h"
 #include "pub_tool_poolalloc.h"
 #include "pub_tool_hashtable.h"
@@ -96,6 +97,40 @@ void delete_MC_Chunk (MC_Chunk* mc);
 static MC_Chunk* freed_list_start[2]  = {NULL, NULL};
 static MC_Chunk* freed_list_end[2]    = {NULL, NULL};
 
+/* Volume of the freed blocks' whole pages given back to the OS. */
+Long MC_(free_queue_discarded_volume) = 0;
+
+/* Released pages are only worth the syscall and the later refaults
+   for blocks that span a fair number of them. */
+#define MIN_DISCARD_SZB (16 * VKI_PAGE_SIZE)
+
+/* A block on the freed list is noaccess, so nothing will look at its
+   contents until it is handed back to the allocator.  Release the
+   whole pages inside it, so that the free queue volume does not stay
+   resident.  Only the pages strictly inside the block are released:
+   the allocator keeps its own metadata just before and after it.
+   The released pages read back as zeroes, so an invalid read of the
+   freed block sees zeroes rather than the old contents. */
+static void discard_freed_block_pages ( MC_Chunk* mc )
+{
+   Addr lo = VG_PGROUNDUP(mc->data);
+   Addr hi = VG_PGROUNDDN(mc->data + mc->szB);
+
+   /* Custom blocks are not ours to release, and the pages would read
+      back as zeroes rather than as the --free-fill value. */
+   if (MC_AllocCustom == mc->allockind
+       || (MC_(clo_free_fill) != -1 && MC_(clo_free_fill) != 0))
+      return;
+   /* A block this big is given back to the allocator at the next
+      allocation (see add_to_freed_queue), and most likely reused. */
+   if (mc->szB >= MC_(clo_freelist_vol))
+      return;
+   if (hi <= lo || hi - lo < MIN_DISCARD_SZB)
+      return;
+   if (VG_(am_discard_client_heap_pages)( lo, hi - lo ))
+      MC_(free_queue_discarded_volume) += (Long)(hi - lo);
+}
+
 /* Put a shadow chunk on the freed blocks queue, possibly freeing up
    some of the oldest blocks in the queue at the same time. */
 static void add_to_freed_queue ( MC_Chunk* mc )
@@ -350,6 +385,56 @@ UInt MC_(n_where_pointers) (void)
    }
 }
 
+/* Number of blocks allocated at sampled and unsampled sites. */
+ULong MC_(n_sampled_blocks)   = 0;
+ULong MC_(n_unsampled_blocks) = 0;
+
+/* Is the block mc allocated at a site chosen by --alloc-site-sampling ?
+   The decision is a hash of the allocation stack trace, so it is the
+   same for all the blocks allocated at a site, and the same from one
+   run to the next as long as the code is loaded at the same addresses.
+   Custom blocks are always checked: their memory is not ours.
+   mc_post_clo_init ensures that the alloc stack trace is kept, but it
+   must be looked at before MC_(set_freed_at) overwrites it with
+   --keep-stacktraces=alloc-then-free. */
+static Bool alloc_site_is_sampled ( MC_Chunk* mc )
+{
+   ExeContext* ec;
+   Addr*       ips;
+   Int         n_ips, i;
+   UWord       h;
+
+   if (LIKELY(MC_(clo_alloc_site_sampling) >= 100)
+       || MC_AllocCustom == mc->allockind)
+      return True;
+   if (MC_(clo_alloc_site_sampling) == 0)
+      return False;
+
+   ec    = MC_(allocated_at)( mc );
+   ips   = VG_(get_ExeContext_StackTrace)( ec );
+   n_ips = VG_(get_ExeContext_n_ips)( ec );
+   h     = 2166136261UL;
+   for (i = 0; i < n_ips; i++) {
+      h ^= ips[i];
+      h *= 16777619UL;
+   }
+   h ^= h >> 16;
+   h *= 0x45d9f3bUL;
+   h ^= h >> 16;
+   return (h % 100) < (UWord)MC_(clo_alloc_site_sampling);
+}
+
+/* Count mc in the sampling statistics, and tell if it is sampled. */
+static Bool count_alloc_site_sample ( MC_Chunk* mc )
+{
+   Bool sampled = alloc_site_is_sampled( mc );
+   if (sampled)
+      MC_(n_sampled_blocks)++;
+   else
+      MC_(n_unsampled_blocks)++;
+   return sampled;
+}
+
 /*------------------------------------------------------------*/
 /*--- client_malloc(), etc                                 ---*/
 /*------------------------------------------------------------*/
@@ -361,6 +446,7 @@ void* MC_(new_block) ( ThreadId tid,
                        VgHashTable *table)
 {
    MC_Chunk* mc;
+   Bool      sampled = True;
 
    // Allocate and zero if necessary
    if (p) {
@@ -386,7 +472,10 @@ void* MC_(new_block) ( ThreadId tid,
    mc = create_MC_Chunk (tid, p, szB, kind);
    VG_(HT_add_node)( table, mc );
 
-   if (is_zeroed)
+   if (UNLIKELY(MC_(clo_alloc_site_sampling) < 100))
+      sampled = count_alloc_site_sample( mc );
+
+   if (is_zeroed || !sampled)
       MC_(make_mem_defined)( p, szB );
    else {
       UInt ecu = VG_(get_ECU_from_ExeContext)(MC_(allocated_at)(mc));
@@ -451,6 +540,9 @@ void* MC_(calloc) ( ThreadId tid, SizeT nmemb, SizeT size1 )
 static
 void die_and_free_mem ( ThreadId tid, MC_Chunk* mc, SizeT rzB )
 {
+   /* Must be decided before MC_(set_freed_at) below. */
+   const Bool sampled = alloc_site_is_sampled( mc );
+
    /* Note: we do not free fill the custom allocs produced
       by MEMPOOL or by MALLOC/FREELIKE_BLOCK requests. */
    if (MC_(clo_free_fill) != -1 && MC_AllocCustom != mc->allockind ) {
@@ -464,6 +556,15 @@ void die_and_free_mem ( ThreadId tid, MC_Chunk* mc, SizeT rzB )
 
    /* Record where freed */
    MC_(set_freed_at) (tid, mc);
+   /* Blocks from unsampled allocation sites are not checked for
+      use after free: give them back right away. */
+   if (!sampled) {
+      VG_(cli_free) ( (void*)(mc->data) );
+      delete_MC_Chunk ( mc );
+      return;
+   }
+   /* Release its pages, but keep its description around */
+   discard_freed_block_pages ( mc );
    /* Put it out of harm's way for a while */
    add_to_freed_queue ( mc );
    /* If the free list volume is bigger than MC_(clo_freelist_vol),
@@ -535,6 +636,7 @@ void* MC_(realloc) ( ThreadId tid, void* p_old, SizeT new_szB )
    MC_Chunk* new_mc;
    Addr      a_new; 
    SizeT     old_szB;
+   Bool      sampled = True;
 
    if (MC_(record_fishy_value_error)(tid, "realloc", "size", new_szB))
       return NULL;
@@ -579,6 +681,10 @@ void* MC_(realloc) ( ThreadId tid, void* p_old, SizeT new_szB )
       // Now insert the new mc (with a new 'data' field) into malloc_list.
       VG_(HT_add_node)( MC_(malloc_list), new_mc );
 
+      // Count it whatever the new size, as it is a new block.
+      if (UNLIKELY(MC_(clo_alloc_site_sampling) < 100))
+         sampled = count_alloc_site_sample( new_mc );
+
       /* Retained part is copied, red zones set as normal */
 
       /* Redzone at the front */
@@ -600,14 +706,19 @@ void* MC_(realloc) ( ThreadId tid, void* p_old, SizeT new_szB )
          MC_(copy_address_range_state) ( (Addr)p_old, a_new, old_szB );
          VG_(memcpy)((void*)a_new, p_old, old_szB);
 
-         // If the block has grown, we mark the grown area as undefined.
+         // If the block has grown, we mark the grown area as undefined,
+         // or as defined if the block comes from an unsampled site.
          // We have to do that after VG_(HT_add_node) to ensure the ecu
          // execontext is for a fully allocated block.
-         ecu = VG_(get_ECU_from_ExeContext)(MC_(allocated_at)(new_mc));
-         tl_assert(VG_(is_plausible_ECU)(ecu));
-         MC_(make_mem_undefined_w_otag)( a_new+old_szB,
-                                         new_szB-old_szB,
-                                         ecu | MC_OKIND_HEAP );
+         if (!sampled) {
+            MC_(make_mem_defined)( a_new+old_szB, new_szB-old_szB );
+         } else {
+            ecu = VG_(get_ECU_from_ExeContext)(MC_(allocated_at)(new_mc));
+            tl_assert(VG_(is_plausible_ECU)(ecu));
+            MC_(make_mem_undefined_w_otag)( a_new+old_szB,
+                                            new_szB-old_szB,
+                                            ecu | MC_OKIND_HEAP );
+         }
 
          /* Possibly fill new area with specified junk */
          if (MC_(clo_malloc_fill) != -1) {
@@ -43,4 +43,9 @@
                   _VG_USERREQ__MEMCHECK_RECORD_OVERLAP_ERROR,   \
                   s, src, dst, len, 0)
 
+#define GET_OK_PREFIX(p, len)                                   \
+  ((SizeT)VALGRIND_DO_CLIENT_REQUEST_EXPR(0,                    \
+                  _VG_USERREQ__MEMCHECK_GET_OK_PREFIX,          \
+                  p, len, 0, 0, 0))
+
 #include "../shared/vg_replace_strmem.c"
@@ -322,6 +322,15 @@ typedef
          0 .. #temps_in_sb-1 (same as for tmpMap). */
       HowUsed* tmpHowUsed;
 
+      /* MODIFIED: for each original tmp, True if its value is known to
+         be completely defined, because it is computed only from
+         constants, always-defined guest state and other such tmps, or
+         because it has already been checked by complainIfUndefined.
+         Such tmps get an all-defined shadow and are not checked again.
+         Valid indices are 0 .. #temps_in_sb-1 (same as for tmpHowUsed). */
+      Bool* tmpDefd;
+      UInt  tmpDefdUsed;
+
       /* READONLY: the guest layout.  This indicates which parts of
          the guest state should be regarded as 'always defined'. */
       const VexGuestLayout* layout;
@@ -466,6 +475,19 @@ static Bool isShadowAtom ( MCEnv* mce, IRAtom* a1 )
    return False;
 }
 
+/* Is this original atom known to be completely defined?  See comments
+   on MCEnv.tmpDefd. */
+static Bool isDefinedAtom ( MCEnv* mce, IRAtom* a1 )
+{
+   if (a1->tag == Iex_Const)
+      return True;
+   if (a1->tag == Iex_RdTmp && mce->tmpDefd) {
+      IRTemp t = a1->Iex.RdTmp.tmp;
+      return t < mce->tmpDefdUsed && mce->tmpDefd[t];
+   }
+   return False;
+}
+
 /* (used for sanity checks only): check that both args are atoms and
    are identically-kinded. */
 static Bool sameKindedAtoms ( IRAtom* a1, IRAtom* a2 )
@@ -1499,6 +1521,11 @@ static void complainIfUndefined ( MCEnv* mce, IRAtom* atom, IRExpr *guard )
       don't really care about the possibility that someone else may
       also create a V-interpretion for it. */
    tl_assert(isOriginalAtom(mce, atom));
+
+   /* Nothing to check if the value is statically known to be defined. */
+   if (isDefinedAtom(mce, atom))
+      return;
+
    vatom = expr2vbits( mce, atom, HuOth );
    tl_assert(isShadowAtom(mce, vatom));
    tl_assert(sameKindedAtoms(atom, vatom));
@@ -1636,6 +1663,9 @@ static void complainIfUndefined ( MCEnv* mce, IRAtom* atom, IRExpr *guard )
          newShadowTmpV(mce, atom->Iex.RdTmp.tmp);
          assign('V', mce, findShadowTmpV(mce, atom->Iex.RdTmp.tmp), 
                           definedOfType(ty));
+         // and later uses of it need not be checked again.
+         if (mce->tmpDefd && atom->Iex.RdTmp.tmp < mce->tmpDefdUsed)
+            mce->tmpDefd[atom->Iex.RdTmp.tmp] = True;
       } else {
          // update the temp only conditionally.  Do this by copying
          // its old value when the guard is False.
@@ -8399,6 +8429,57 @@ static void preInstrumentationAnalysis ( /*OUT*/HowUsed** useEnvP,
 }
 
 
+/* Is the value of this original expression known to be completely
+   defined?  This is the case if all its operands are (see
+   isDefinedAtom), as V bit propagation of completely defined operands
+   always gives a completely defined result, or if it reads an always
+   defined part of the guest state.  Loads are never known to be
+   defined.  This is used to do a forward definedness analysis during
+   instrumentation, see MCEnv.tmpDefd. */
+static Bool isDefinedExpr ( MCEnv* mce, IRExpr* e )
+{
+   switch (e->tag) {
+      case Iex_Const:
+      case Iex_RdTmp:
+         return isDefinedAtom(mce, e);
+      case Iex_Get:
+         return e->Iex.Get.ty != Ity_I1 && e->Iex.Get.ty != Ity_I128
+                && isAlwaysDefd(mce, e->Iex.Get.offset,
+                                sizeofIRType(e->Iex.Get.ty));
+      case Iex_Unop:
+         return isDefinedAtom(mce, e->Iex.Unop.arg);
+      case Iex_Binop:
+         return isDefinedAtom(mce, e->Iex.Binop.arg1)
+                && isDefinedAtom(mce, e->Iex.Binop.arg2);
+      case Iex_Triop: {
+         IRTriop* tri = e->Iex.Triop.details;
+         return isDefinedAtom(mce, tri->arg1)
+                && isDefinedAtom(mce, tri->arg2)
+                && isDefinedAtom(mce, tri->arg3);
+      }
+      case Iex_Qop: {
+         IRQop* qop = e->Iex.Qop.details;
+         return isDefinedAtom(mce, qop->arg1)
+                && isDefinedAtom(mce, qop->arg2)
+                && isDefinedAtom(mce, qop->arg3)
+                && isDefinedAtom(mce, qop->arg4);
+      }
+      case Iex_ITE:
+         return isDefinedAtom(mce, e->Iex.ITE.cond)
+                && isDefinedAtom(mce, e->Iex.ITE.iftrue)
+                && isDefinedAtom(mce, e->Iex.ITE.iffalse);
+      case Iex_CCall:
+         for (IRExpr** args = e->Iex.CCall.args; *args; args++) {
+            if (!isDefinedAtom(mce, *args))
+               return False;
+         }
+         return True;
+      default:
+         return False;
+   }
+}
+
+
 IRSB* MC_(instrument) ( VgCallbackClosure* closure,
                         IRSB* sb_in, 
                         const VexGuestLayout* layout, 
@@ -8542,6 +8623,11 @@ IRSB* MC_(instrument) ( VgCallbackClosure* closure,
    }
    tl_assert( VG_(sizeXA)( mce.tmpMap ) == sb_in->tyenv->types_used );
 
+   /* Nothing is known to be defined yet. */
+   mce.tmpDefdUsed = sb_in->tyenv->types_used;
+   mce.tmpDefd = VG_(calloc)( "mc.MC_(instrument).2",
+                              mce.tmpDefdUsed + 1, sizeof(Bool) );
+
    /* Finally, begin instrumentation. */
    /* Copy verbatim any IR preamble preceding the first IMark */
 
@@ -8589,6 +8675,7 @@ IRSB* MC_(instrument) ( VgCallbackClosure* closure,
          IRTemp tmp_v = findShadowTmpV(&mce, tmp_o);
          IRType ty_v  = typeOfIRTemp(sb_out->tyenv, tmp_v);
          assign( 'V', &mce, tmp_v, definedOfType( ty_v ) );
+         mce.tmpDefd[tmp_o] = True;
          if (MC_(clo_mc_level) == 3) {
             IRTemp tmp_b = findShadowTmpB(&mce, tmp_o);
             tl_assert(typeOfIRTemp(sb_out->tyenv, tmp_b) == Ity_I32);
@@ -8635,8 +8722,16 @@ IRSB* MC_(instrument) ( VgCallbackClosure* closure,
             tl_assert(dst < (UInt)sb_in->tyenv->types_used);
             HowUsed hu = mce.tmpHowUsed ? mce.tmpHowUsed[dst]
                                         : HuOth/*we don't know, so play safe*/;
-            assign( 'V', &mce, findShadowTmpV(&mce, st->Ist.WrTmp.tmp), 
-                               expr2vbits( &mce, st->Ist.WrTmp.data, hu ));
+            if (isDefinedExpr( &mce, st->Ist.WrTmp.data )) {
+               /* No need to compute the V bits, they are all zero. */
+               IRTemp dstV = findShadowTmpV(&mce, dst);
+               assign( 'V', &mce, dstV,
+                       definedOfType( typeOfIRTemp(sb_out->tyenv, dstV) ));
+               mce.tmpDefd[dst] = True;
+            } else {
+               assign( 'V', &mce, findShadowTmpV(&mce, st->Ist.WrTmp.tmp), 
+                                  expr2vbits( &mce, st->Ist.WrTmp.data, hu ));
+            }
             break;
          }
 
@@ -8758,6 +8853,7 @@ IRSB* MC_(instrument) ( VgCallbackClosure* closure,
    if (mce.tmpHowUsed) {
       VG_(free)( mce.tmpHowUsed );
    }
+   VG_(free)( mce.tmpDefd );
 
    tl_assert(mce.sb == sb_out);
    return sb_out;
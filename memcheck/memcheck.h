@@ -99,9 +99,13 @@ typedef
       VG_USERREQ__ENABLE_ADDR_ERROR_REPORTING_IN_RANGE,
       VG_USERREQ__DISABLE_ADDR_ERROR_REPORTING_IN_RANGE,
 
-      /* This is just for memcheck's internal use - don't use it */
+      /* These are just for memcheck's internal use - don't use them.
+         They are not part of the client request API, and may change
+         or go away in any release. */
       _VG_USERREQ__MEMCHECK_RECORD_OVERLAP_ERROR 
-         = VG_USERREQ_TOOL_BASE('M','C') + 256
+         = VG_USERREQ_TOOL_BASE('M','C') + 256,
+      _VG_USERREQ__MEMCHECK_GET_OK_PREFIX
+         = VG_USERREQ_TOOL_BASE('M','C') + 257
    } Vg_MemCheckClientRequest;
 
 
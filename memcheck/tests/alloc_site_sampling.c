@@ -0,0 +1,120 @@
+/* Test --alloc-site-sampling.  A block allocated at an unsampled site
+   is defined from the start, and is given back to the allocator as
+   soon as it is freed, so that a new block of the same size reuses it.
+   A block allocated at a sampled site is undefined, and is queued when
+   it is freed.  Each call in main is a different allocation site.
+   Which sites are sampled depends on the code addresses, so the exact
+   outcome of each site is only shown when an argument is given. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "../memcheck.h"
+
+#define SZB 100
+#define N_SITES 16
+
+static const char* result[N_SITES];
+static int n_results = 0;
+static int detail = 0;
+static char* keep;
+
+/* Returns 1 if the block is defined, 0 if it is undefined. */
+static int is_defined ( char* p )
+{
+   char vbits;
+   (void)VALGRIND_GET_VBITS(p, &vbits, 1);
+   return vbits == 0;
+}
+
+/* Returns 1 if freeing p made it available for the next malloc.
+   The new block is not freed, so that it cannot be reused instead. */
+static int is_reused_after_free ( char* p )
+{
+   free(p);
+   keep = malloc(SZB);
+   return keep == p;
+}
+
+static void check_malloc ( char* p )
+{
+   int defined = is_defined(p);
+   int reused  = is_reused_after_free(p);
+   if (defined != reused)
+      result[n_results++] = "malloc: inconsistent";
+   else if (!detail)
+      result[n_results++] = "malloc: ok";
+   else if (reused)
+      result[n_results++] = "malloc: unchecked";
+   else
+      result[n_results++] = "malloc: checked";
+}
+
+static void check_calloc ( char* p )
+{
+   int defined = is_defined(p);
+   int reused  = is_reused_after_free(p);
+   if (!defined)
+      result[n_results++] = "calloc: undefined";
+   else if (!detail)
+      result[n_results++] = "calloc: ok";
+   else if (reused)
+      result[n_results++] = "calloc: unchecked";
+   else
+      result[n_results++] = "calloc: checked";
+}
+
+/* The block grown by realloc is a new block, from the realloc site.
+   Its grown part is defined if and only if that site is unsampled. */
+static void check_realloc ( char* p )
+{
+   int defined = is_defined(p + SZB / 2);
+   int reused  = is_reused_after_free(p);
+   if (defined != reused)
+      result[n_results++] = "realloc: inconsistent";
+   else if (!detail)
+      result[n_results++] = "realloc: ok";
+   else if (reused)
+      result[n_results++] = "realloc: unchecked";
+   else
+      result[n_results++] = "realloc: checked";
+}
+
+/* The blocks either side of the small block stay allocated, so that
+   the small block, freed by realloc, cannot be merged into a free
+   block big enough to be taken for p. */
+static char* small_block ( void )
+{
+   char* p;
+   keep = malloc(SZB / 2);
+   p    = malloc(SZB / 2);
+   keep = malloc(SZB / 2);
+   return p;
+}
+
+int main ( int argc, char** argv )
+{
+   int i;
+
+   detail = argc > 1;
+
+   check_malloc(malloc(SZB));
+   check_malloc(malloc(SZB));
+   check_malloc(malloc(SZB));
+   check_malloc(malloc(SZB));
+   check_malloc(malloc(SZB));
+   check_malloc(malloc(SZB));
+   check_calloc(calloc(1, SZB));
+   check_calloc(calloc(1, SZB));
+   check_calloc(calloc(1, SZB));
+   check_calloc(calloc(1, SZB));
+   check_calloc(calloc(1, SZB));
+   check_realloc(realloc(small_block(), SZB));
+   check_realloc(realloc(small_block(), SZB));
+   check_realloc(realloc(small_block(), SZB));
+   check_realloc(realloc(small_block(), SZB));
+   check_realloc(realloc(small_block(), SZB));
+
+   for (i = 0; i < n_results; i++)
+      printf("%s\n", result[i]);
+   return 0;
+}
@@ -0,0 +1,65 @@
+
+/* Check that memcheck tracks the state of memory mapped above the
+   128G covered by its main primary map, including a mapping which
+   straddles the 4G boundary between two high map leaves. */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include "../../memcheck.h"
+
+#define LEN 65536
+
+static char* map_at ( unsigned long addr )
+{
+   char* p = mmap((void*)addr, LEN, PROT_READ|PROT_WRITE,
+                  MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED, -1, 0);
+   if (p == MAP_FAILED) {
+      perror("mmap");
+      exit(1);
+   }
+   return p;
+}
+
+static void test ( const char* what, char* p )
+{
+   char* copy = malloc(LEN);
+   long  sum  = 0;
+   int   i;
+
+   printf("%s\n", what);
+   /* Mapped memory is defined; writing and reading it is fine. */
+   for (i = 0; i < LEN; i += 7)
+      p[i] = (char)i;
+   for (i = 0; i < LEN; i += 7)
+      sum += p[i];
+   printf("sum %ld\n", sum);
+
+   /* An undefined byte is found, including after being copied. */
+   (void) VALGRIND_MAKE_MEM_UNDEFINED(p + LEN / 2 - 3, 8);
+   if (p[LEN / 2])
+      printf("nonzero\n");
+   memcpy(copy, p, LEN);
+   if (copy[LEN / 2 + 1])
+      printf("nonzero\n");
+   free(copy);
+
+   /* The end of the mapping is found. */
+   if (VALGRIND_CHECK_MEM_IS_ADDRESSABLE(p, LEN + 100)
+       != (unsigned long)(p + LEN))
+      printf("wrong end of mapping\n");
+
+   /* And it is all unaddressable after being unmapped. */
+   munmap(p, LEN);
+   if (VALGRIND_CHECK_MEM_IS_ADDRESSABLE(p + 10, 10)
+       != (unsigned long)(p + 10))
+      printf("still addressable after munmap\n");
+}
+
+int main ( void )
+{
+   test("at 192G", map_at(0x3000000000UL));
+   test("across the 4G boundary at 260G", map_at(0x4100000000UL - LEN / 2));
+   return 0;
+}
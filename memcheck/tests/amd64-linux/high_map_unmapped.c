@@ -0,0 +1,51 @@
+
+/* Check that looking up the shadow of unmapped addresses above the
+   main primary map does not allocate high map leaves for them, and
+   that the high map stays consistent (checked by the expensive sanity
+   checks, see --sanity-level) as leaves are added. */
+
+#include <stdio.h>
+#include <sys/mman.h>
+#include "../../memcheck.h"
+
+#define GB4  0x100000000UL
+
+static void show_leaves ( const char* when )
+{
+   fprintf(stderr, "%s\n", when);
+   VALGRIND_MONITOR_COMMAND("v.info stats");
+}
+
+int main ( void )
+{
+   unsigned long i;
+   unsigned char vbits;
+   int           n_unaddressable = 0;
+   char*         p;
+
+   show_leaves("at start");
+
+   /* One lookup in each of 8 distinct, unmapped 4G ranges above the
+      128G covered by the main primary map. */
+   for (i = 0; i < 8; i++) {
+      char* a = (char*)(0x5000000000UL + i * GB4 + 4096 * i + 4);
+      if (VALGRIND_GET_VBITS(a, &vbits, 1) == 3)
+         n_unaddressable++;
+      if (VALGRIND_CHECK_MEM_IS_ADDRESSABLE(a, 16) != (unsigned long)a)
+         fprintf(stderr, "%p: wrong first bad address\n", a);
+   }
+   fprintf(stderr, "%d of 8 unaddressable\n", n_unaddressable);
+   show_leaves("after reading unmapped high addresses");
+
+   /* Now map something in one of them; that needs a leaf. */
+   p = mmap((void*)(0x5000000000UL + 3 * GB4), 65536, PROT_READ|PROT_WRITE,
+            MAP_PRIVATE|MAP_ANONYMOUS|MAP_FIXED, -1, 0);
+   if (p == MAP_FAILED) {
+      perror("mmap");
+      return 1;
+   }
+   p[100] = 1;
+   show_leaves("after mapping a high address");
+   munmap(p, 65536);
+   return 0;
+}
@@ -0,0 +1,78 @@
+
+/* Check that memcheck's tracking of temporaries which are statically
+   known to be defined does not lose errors when such a value is later
+   overwritten conditionally, and does not report an undefined value
+   more than once after it has been checked. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../../memcheck.h"
+
+#define JZ_NEXT ".byte 0x74,0x00"  /* jz the-next-insn */
+
+int main ( void )
+{
+   long* junk = malloc(16);
+   assert(junk);
+   junk[0] = 0;
+   junk[1] = 0;
+   /* Zero, so they can be used as an index, but undefined. */
+   (void) VALGRIND_MAKE_MEM_UNDEFINED(junk, 16);
+
+   printf("\nComplain defined value replaced by undefined one\n");
+   __asm__ __volatile__(
+      "movq   $5, %%rax\n\t"
+      "movq   $1, %%rcx\n\t"
+      "movq   0(%0), %%r8\n\t"
+      "testq  %%rcx, %%rcx\n\t"
+      "cmovnzq %%r8, %%rax\n\t"
+      "cmpq   $0, %%rax\n\t"
+      JZ_NEXT
+      : : "r"(junk) : "r8", "rax", "rcx", "cc"
+   );
+
+   printf("\nNo complain defined value not replaced\n");
+   __asm__ __volatile__(
+      "movq   $5, %%rax\n\t"
+      "movq   $0, %%rcx\n\t"
+      "movq   0(%0), %%r8\n\t"
+      "testq  %%rcx, %%rcx\n\t"
+      "cmovnzq %%r8, %%rax\n\t"
+      "cmpq   $0, %%rax\n\t"
+      JZ_NEXT
+      : : "r"(junk) : "r8", "rax", "rcx", "cc"
+   );
+
+   printf("\nComplain defined value replaced on undefined condition\n");
+   __asm__ __volatile__(
+      "movq   $5, %%rax\n\t"
+      "movq   $7, %%r8\n\t"
+      "movq   0(%0), %%rcx\n\t"
+      "testq  %%rcx, %%rcx\n\t"
+      "cmovnzq %%r8, %%rax\n\t"
+      "cmpq   $0, %%rax\n\t"
+      JZ_NEXT
+      : : "r"(junk) : "r8", "rax", "rcx", "cc"
+   );
+
+   printf("\nComplain once undefined address used twice\n");
+   __asm__ __volatile__(
+      "movq   0(%0), %%rax\n\t"
+      "movq   0(%0,%%rax,1), %%r8\n\t"
+      "movq   8(%0,%%rax,1), %%rcx\n\t"
+      : : "r"(junk) : "r8", "rax", "rcx", "memory"
+   );
+
+   printf("\nComplain twice checked value modified\n");
+   __asm__ __volatile__(
+      "movq   0(%0), %%rax\n\t"
+      "movq   0(%0,%%rax,1), %%r8\n\t"
+      "addq   8(%0), %%rax\n\t"
+      "movq   0(%0,%%rax,1), %%rcx\n\t"
+      : : "r"(junk) : "r8", "rax", "rcx", "memory", "cc"
+   );
+
+   free(junk);
+   return 0;
+}
@@ -0,0 +1,178 @@
+
+/* Check that memcheck keeps the exact V+A state of every byte when it
+   fills, copies and checks ranges of shadow memory a whole sec-map
+   piece at a time.  The ranges start and end at every alignment, and
+   cover part of one sec-map, span the boundary between two, or cover
+   a whole one. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../memcheck.h"
+
+#define SM_SIZE  65536   /* client bytes covered by a sec-map */
+#define MARGIN   64      /* bytes either side of a range also checked */
+#define NOACCESS 0x100   /* byte_state() of an unaddressable byte */
+
+typedef enum { Defined, Undefined, NoAccess } Perm;
+
+static const char* perm_name[] = { "defined", "undefined", "noaccess" };
+
+static int n_failed = 0;
+
+/* The V bits of the byte at p, or NOACCESS. */
+static int byte_state ( char* p )
+{
+   unsigned char vbits;
+   if (VALGRIND_GET_VBITS(p, &vbits, 1) == 3)
+      return NOACCESS;
+   return vbits;
+}
+
+static void set_perm ( char* p, size_t len, Perm perm )
+{
+   switch (perm) {
+      case Defined:   (void) VALGRIND_MAKE_MEM_DEFINED(p, len);   break;
+      case Undefined: (void) VALGRIND_MAKE_MEM_UNDEFINED(p, len); break;
+      case NoAccess:  (void) VALGRIND_MAKE_MEM_NOACCESS(p, len);  break;
+   }
+}
+
+static int perm_state ( Perm perm )
+{
+   switch (perm) {
+      case Defined:   return 0x00;
+      case Undefined: return 0xff;
+      default:        return NOACCESS;
+   }
+}
+
+/* Check that [p, p+len) is in state perm and that the MARGIN bytes
+   either side of it are defined. */
+static void check_range ( const char* what, char* p, size_t len, Perm perm )
+{
+   char*  q;
+   for (q = p - MARGIN; q < p + len + MARGIN; q++) {
+      int want = (q >= p && q < p + len) ? perm_state(perm) : 0x00;
+      int got  = byte_state(q);
+      if (got != want) {
+         printf("%s: byte %ld is 0x%x, expected 0x%x\n",
+                what, (long)(q - p), got, want);
+         n_failed++;
+         return;
+      }
+   }
+}
+
+/* Check that the range checking requests find the first bad byte of
+   [p, p+len), starting from the aligned and unaligned addresses just
+   before it. */
+static void check_first_bad ( const char* what, char* p, size_t len,
+                              Perm perm )
+{
+   size_t before;
+   for (before = 1; before <= 8; before++) {
+      char*  start = p - before;
+      size_t n     = before + len;
+      char*  bad   = perm == NoAccess
+                        ? (char*)VALGRIND_CHECK_MEM_IS_ADDRESSABLE(start, n)
+                        : (char*)VALGRIND_CHECK_MEM_IS_DEFINED(start, n);
+      if (bad != p) {
+         printf("%s: first bad byte from %ld bytes before is %ld\n",
+                what, (long)before, bad ? (long)(bad - p) : -1L);
+         n_failed++;
+         return;
+      }
+   }
+}
+
+static void test_fill ( char* region, size_t region_len )
+{
+   static const size_t starts[]
+      = { 4, 5, 8, 11, SM_SIZE - 3, SM_SIZE, SM_SIZE + 1,
+          2 * SM_SIZE - 8 };
+   static const size_t lens[]
+      = { 1, 7, 8, 13, 100, SM_SIZE - 5, SM_SIZE + SM_SIZE / 2 + 3,
+          2 * SM_SIZE + 9 };
+   size_t s, l;
+   int    perm;
+   char   what[100];
+
+   for (s = 0; s < sizeof(starts) / sizeof(starts[0]); s++) {
+      for (l = 0; l < sizeof(lens) / sizeof(lens[0]); l++) {
+         for (perm = Undefined; perm <= NoAccess; perm++) {
+            char* p = region + MARGIN + starts[s];
+            sprintf(what, "fill %s start %lu len %lu", perm_name[perm],
+                    (unsigned long)starts[s], (unsigned long)lens[l]);
+            set_perm(region, region_len, Defined);
+            set_perm(p, lens[l], perm);
+            check_range(what, p, lens[l], perm);
+            check_first_bad(what, p, lens[l], perm);
+            /* Refill part of it, from an unaligned address. */
+            if (lens[l] > 3) {
+               set_perm(p + 3, lens[l] - 3, Defined);
+               check_range(what, p, 3, perm);
+            }
+         }
+      }
+   }
+}
+
+/* Give [p, p+len) a mix of defined, undefined, partially defined and
+   unaddressable bytes, changing at unaligned addresses. */
+static void scramble ( char* p, size_t len )
+{
+   size_t i;
+   unsigned char vbits = 0x0f;
+   set_perm(p, len, Defined);
+   for (i = 1; i + 1000 < len; i += 997) {
+      set_perm(p + i, 101 + i % 13, Undefined);
+      (void) VALGRIND_SET_VBITS(p + i + 300, &vbits, 1);
+      if (i % 3 == 0)
+         set_perm(p + i + 500, 5 + i % 7, NoAccess);
+   }
+}
+
+static void test_copy ( size_t len )
+{
+   char*  p     = malloc(len);
+   int*   state = malloc(len * sizeof(int));
+   size_t i;
+   char   what[100];
+
+   sprintf(what, "copy len %lu", (unsigned long)len);
+   scramble(p, len);
+   for (i = 0; i < len; i++)
+      state[i] = byte_state(p + i);
+   /* Moves the block, copying the state of all len bytes. */
+   p = realloc(p, len + SM_SIZE);
+   for (i = 0; i < len; i++) {
+      int got = byte_state(p + i);
+      if (got != state[i]) {
+         printf("%s: byte %lu is 0x%x, expected 0x%x\n",
+                what, (unsigned long)i, got, state[i]);
+         n_failed++;
+         break;
+      }
+   }
+   free(p);
+   free(state);
+}
+
+int main ( void )
+{
+   size_t region_len = 5 * SM_SIZE;
+   char*  region     = malloc(region_len);
+
+   test_fill(region, region_len);
+   free(region);
+
+   test_copy(3);
+   test_copy(1001);
+   test_copy(SM_SIZE - 13);
+   test_copy(SM_SIZE + 4000);
+   test_copy(3 * SM_SIZE + 1);
+
+   printf("%s\n", n_failed ? "FAILED" : "ok");
+   return 0;
+}
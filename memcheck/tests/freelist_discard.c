@@ -0,0 +1,37 @@
+/* Test that the pages of big blocks waiting in the freed blocks queue
+   are given back to the OS (they then read back as zeroes), while
+   small blocks and blocks bigger than --freelist-vol keep their
+   contents.  Run with --freelist-vol=10000000 and with
+   --freelist-vol=0. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../memcheck.h"
+
+static void check ( const char* desc, size_t szB )
+{
+   unsigned char* p = malloc(szB);
+   unsigned char c;
+
+   if (p == NULL)
+      return;
+   memset(p, 0x55, szB);
+   free(p);
+   /* Look at the middle of the block before anything else gets
+      allocated, as this could recycle the block. */
+   VALGRIND_DISABLE_ERROR_REPORTING;
+   c = p[szB / 2];
+   VALGRIND_ENABLE_ERROR_REPORTING;
+   (void)VALGRIND_MAKE_MEM_DEFINED(&c, 1);
+   printf("%s: %s\n", desc, c == 0x55 ? "old contents" : "zeroes");
+}
+
+int main ( void )
+{
+   printf("start\n");
+   check("small block", 8 * 4096);
+   check("big block", 1024 * 1024);
+   check("block bigger than the queue", 12 * 1024 * 1024);
+   return 0;
+}
@@ -0,0 +1,78 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../memcheck.h"
+#include "leak.h"
+
+// Leak searches with --leak-check-incremental=yes reuse the scan of the
+// pages which were not written since the previous search.  Check that a
+// page written between two searches is scanned again, whether the write
+// adds or removes the only pointer to a block.
+
+#define N_PAGES 64
+
+static long* region;
+static char* a;
+static char* b;
+static long  page_words;
+
+static void breakme(void) {}
+
+static void f(void)
+{
+   long i;
+
+   page_words = sysconf(_SC_PAGESIZE) / sizeof(long);
+   region = mmap(NULL, N_PAGES * page_words * sizeof(long),
+                 PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+   if (region == MAP_FAILED)
+      return;
+   for (i = 0; i < N_PAGES * page_words; i++)
+      region[i] = i;
+
+   a = malloc(100);
+   b = malloc(200);
+
+   fprintf(stderr, "expecting details 100 and 200 bytes reachable\n");
+   fflush(stderr); breakme();
+   VALGRIND_DO_LEAK_CHECK;
+
+   fprintf(stderr, "expecting to have NO details\n"); fflush(stderr); breakme();
+   VALGRIND_DO_ADDED_LEAK_CHECK;
+
+   // The only pointer to b is now in a page of the region.
+   region[37 * page_words + 5] = (long)b;
+   b = NULL;
+   a = NULL;
+   fprintf(stderr, "expecting details -100 bytes reachable, +100 bytes lost\n");
+   fflush(stderr); breakme();
+   VALGRIND_DO_CHANGED_LEAK_CHECK;
+
+   fprintf(stderr, "expecting to have NO details\n"); fflush(stderr); breakme();
+   VALGRIND_DO_CHANGED_LEAK_CHECK;
+
+   // Lose b.
+   region[37 * page_words + 5] = 0;
+   fprintf(stderr, "expecting details -200 bytes reachable, +200 bytes lost\n");
+   fflush(stderr); breakme();
+   VALGRIND_DO_CHANGED_LEAK_CHECK;
+
+   fprintf(stderr, "finished\n");
+}
+
+int main(void)
+{
+   DECLARE_LEAK_COUNTERS;
+
+   GET_INITIAL_LEAK_COUNTS;
+
+   f();
+
+   CLEAR_CALLER_SAVED_REGS;
+   GET_FINAL_LEAK_COUNTS;
+
+   PRINT_LEAK_COUNTS(stderr);
+
+   return 0;
+}
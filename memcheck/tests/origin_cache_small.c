@@ -0,0 +1,68 @@
+
+/* Check that origins survive being evicted from a tiny origin cache
+   (see origin_cache_small.vgtest) to its backing table and being
+   refilled from it, both for blocks whose origins were set by malloc
+   and for copies of them. */
+
+#include <stdlib.h>
+#include <string.h>
+
+#define N_BLOCKS 8
+#define SIZE     4096
+
+static char* blocks[N_BLOCKS];
+static char* copies[N_BLOCKS];
+static int   n_nonzero = 0;
+
+__attribute__((noinline)) static char* alloc_even ( void )
+{
+   return malloc(SIZE);
+}
+
+__attribute__((noinline)) static char* alloc_odd ( void )
+{
+   return malloc(SIZE);
+}
+
+/* Each use is on its own line, so that each gives its own error. */
+#define USE(p) do { if ((p)[SIZE / 2 + 5]) n_nonzero++; } while (0)
+
+int main ( void )
+{
+   int i;
+
+   /* All of these together are far bigger than the origin cache. */
+   for (i = 0; i < N_BLOCKS; i++)
+      blocks[i] = i % 2 == 0 ? alloc_even() : alloc_odd();
+   for (i = 0; i < N_BLOCKS; i++) {
+      copies[i] = malloc(SIZE);
+      memset(copies[i], 0, SIZE);
+   }
+   for (i = 0; i < N_BLOCKS; i++)
+      memcpy(copies[i], blocks[i], SIZE);
+
+   /* Oldest first, so that every origin has to come back from the
+      backing table. */
+   USE(blocks[0]);
+   USE(blocks[1]);
+   USE(blocks[2]);
+   USE(blocks[3]);
+   USE(blocks[4]);
+   USE(blocks[5]);
+   USE(blocks[6]);
+   USE(blocks[7]);
+   USE(copies[0]);
+   USE(copies[1]);
+   USE(copies[2]);
+   USE(copies[3]);
+   USE(copies[4]);
+   USE(copies[5]);
+   USE(copies[6]);
+   USE(copies[7]);
+
+   for (i = 0; i < N_BLOCKS; i++) {
+      free(blocks[i]);
+      free(copies[i]);
+   }
+   return 0;
+}
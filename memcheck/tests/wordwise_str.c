@@ -0,0 +1,83 @@
+/* strlen, strcmp and memchr scan long strings a word at a time, in the
+   prefix that Memcheck reports to be addressable and defined.  Check
+   that an undefined or unaddressable byte past that prefix is still
+   reported at its exact place, and that undefined bytes past the end
+   of the string are not reported at all.  The bad byte is at BAD, or
+   at 67 for the strings starting at an odd address. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../memcheck.h"
+
+#define SIZE  256
+#define LEN   199   /* the string ends here */
+#define BAD   150   /* the bad byte, well past the first 64 bytes */
+
+/* Returns a string of LEN 'x's in a block of SIZE bytes, with the
+   bytes after the terminating zero undefined. */
+static char* make_string(void)
+{
+   char* s = malloc(SIZE);
+   memset(s, 'x', LEN);
+   s[LEN] = 0;
+   VALGRIND_MAKE_MEM_UNDEFINED(s + LEN + 1, SIZE - LEN - 1);
+   return s;
+}
+
+typedef size_t (*strlen_t)(const char*);
+typedef int    (*strcmp_t)(const char*, const char*);
+typedef void*  (*memchr_t)(const void*, int, size_t);
+
+/* Called through volatile pointers, so that the compiler does not
+   expand them inline. */
+static volatile strlen_t my_strlen = strlen;
+static volatile strcmp_t my_strcmp = strcmp;
+static volatile memchr_t my_memchr = memchr;
+
+/* Looks for a 'y' put at the end of s. */
+static void find_y(char* s)
+{
+   char* p;
+
+   s[LEN] = 'y';
+   p = my_memchr(s, 'y', SIZE);
+   s[LEN] = 0;
+   printf("memchr %d\n", p ? (int)(p - s) : -1);
+}
+
+int main(void)
+{
+   char* s = make_string();
+   char* t = make_string();
+
+   fprintf(stderr, "-- defined strings\n");
+   printf("strlen %zu\n", my_strlen(s));
+   printf("strcmp %d\n", my_strcmp(s, t));
+   find_y(s);
+
+   fprintf(stderr, "-- undefined byte %d\n", BAD);
+   VALGRIND_MAKE_MEM_UNDEFINED(s + BAD, 1);
+   printf("strlen %zu\n", my_strlen(s));
+   printf("strcmp %d\n", my_strcmp(t, s));
+   find_y(s);
+   s[BAD] = 'x';
+
+   fprintf(stderr, "-- unaddressable byte %d\n", BAD);
+   VALGRIND_MAKE_MEM_NOACCESS(s + BAD, 1);
+   printf("strlen %zu\n", my_strlen(s));
+   printf("strcmp %d\n", my_strcmp(t, s));
+   find_y(s);
+   VALGRIND_MAKE_MEM_DEFINED(s + BAD, 1);
+
+   /* The scan of the first string then stops at an unaligned address,
+      2 bytes into the second one's next granule. */
+   fprintf(stderr, "-- undefined byte 67, strings at offset 1\n");
+   VALGRIND_MAKE_MEM_UNDEFINED(s + 67, 1);
+   printf("strcmp %d\n", my_strcmp(s + 1, t + 1));
+   s[67] = 'x';
+
+   free(s);
+   free(t);
+   return 0;
+}
@@ -0,0 +1,79 @@
+/* A signal interrupting a loop that jumps back to its own start must
+   see, in its context, the flags of the last flag-setting instruction
+   of the loop, even though the next iteration overwrites them without
+   reading them. */
+#define _GNU_SOURCE
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <ucontext.h>
+
+#define ZF 0x40
+#define SF 0x80
+#define PF 0x04
+
+extern char loop_start[], loop_end[];
+
+static volatile int n_sigs = 0;
+static volatile int n_checked = 0;
+static volatile int n_bad = 0;
+
+static void handler(int sig, siginfo_t* si, void* uc_v)
+{
+   ucontext_t*   uc    = uc_v;
+   char*         rip   = (char*)uc->uc_mcontext.gregs[REG_RIP];
+   unsigned long flags = uc->uc_mcontext.gregs[REG_EFL];
+   long          n     = uc->uc_mcontext.gregs[REG_RBX];
+   unsigned long exp   = 0;
+
+   if (rip >= loop_start && rip < loop_end) {
+      /* The flags are those of the add that produced n. */
+      if (n == 0)
+         exp |= ZF;
+      if (n < 0)
+         exp |= SF;
+      if (!__builtin_parity(n & 0xFF))
+         exp |= PF;
+      if ((flags & (ZF | SF | PF)) != exp)
+         n_bad++;
+      n_checked++;
+   }
+   if (++n_sigs == 20)
+      uc->uc_mcontext.gregs[REG_RIP] = (long)loop_end;
+}
+
+int main(void)
+{
+   struct sigaction sa;
+   struct itimerval it;
+
+   memset(&sa, 0, sizeof(sa));
+   sa.sa_sigaction = handler;
+   sa.sa_flags = SA_SIGINFO | SA_RESTART;
+   sigaction(SIGALRM, &sa, NULL);
+
+   it.it_interval.tv_sec = 0;
+   it.it_interval.tv_usec = 10000;
+   it.it_value = it.it_interval;
+   setitimer(ITIMER_REAL, &it, NULL);
+
+   /* Loops until the handler moves the program counter to loop_end. */
+   __asm__ __volatile__(
+      "movq $-100, %%rbx\n"
+      ".globl loop_start\n"
+      "loop_start:\n\t"
+      "addq $1, %%rbx\n\t"
+      "jmp loop_start\n"
+      ".globl loop_end\n"
+      "loop_end:\n\t"
+      : : : "rbx", "cc", "memory");
+
+   it.it_value.tv_sec = it.it_value.tv_usec = 0;
+   it.it_interval = it.it_value;
+   setitimer(ITIMER_REAL, &it, NULL);
+
+   printf("%s\n", n_checked > 0 && n_bad == 0
+                  ? "flags ok" : "wrong flags in the signal context");
+   return 0;
+}
@@ -176,6 +176,123 @@ static inline void my_exit ( int x )
 #ifndef VALGRIND_CHECK_VALUE_IS_DEFINED
 #define VALGRIND_CHECK_VALUE_IS_DEFINED(__lvalue) 1
 #endif
+// Returns the length of a prefix of [p, p+len) that the tool guarantees
+// to be addressable and defined, hence safe to read a word at a time:
+// reading a byte of it past the end of the string being scanned can
+// neither cause nor hide an error.  Tools that don't provide this get 0,
+// and the functions below then only ever read byte by byte.
+#ifndef GET_OK_PREFIX
+#define GET_OK_PREFIX(p, len) ((SizeT)0)
+#endif
+
+
+/* Word-at-a-time scanning.  Scanning starts byte by byte, since most
+   strings are short and asking the tool for the OK prefix costs as much
+   as scanning a few dozen bytes.  Past WORDWISE_MIN bytes, the scan asks
+   for the OK prefix of the next WORDWISE_CHUNK bytes and goes through
+   it a word at a time, then asks again, until the prefix gets too short
+   to bother.  The rest is scanned byte by byte, as before. */
+#define WORDWISE_MIN    64
+#define WORDWISE_CHUNK  4096
+
+#define WORD_ONES   ((UWord)0x0101010101010101ULL)
+#define WORD_HIGHS  ((UWord)0x8080808080808080ULL)
+// Nonzero iff some byte of w is zero.
+#define WORD_HAS_ZERO_BYTE(w)  (((w) - WORD_ONES) & ~(w) & WORD_HIGHS)
+
+/* Returns the index of the first zero byte in s at or after i, if it
+   lies within the OK prefixes; else the index at which byte-by-byte
+   scanning must resume. */
+static inline __attribute__((always_inline))
+SizeT wordwise_strlen_from ( const HChar* s, SizeT i )
+{
+   const Addr WM = sizeof(UWord) - 1;
+   while (True) {
+      Addr a   = (Addr)s + i;
+      Addr end = a + GET_OK_PREFIX(a, WORDWISE_CHUNK);
+      if (end - a < 4 * sizeof(UWord))
+         return i;
+      while ((a & WM) != 0) {
+         if (*(const UChar*)a == 0) return a - (Addr)s;
+         a++;
+      }
+      while (a + sizeof(UWord) <= end
+             && !WORD_HAS_ZERO_BYTE(*(const UWord*)a))
+         a += sizeof(UWord);
+      while (a < end) {
+         if (*(const UChar*)a == 0) return a - (Addr)s;
+         a++;
+      }
+      i = a - (Addr)s;
+   }
+}
+
+/* Returns the index at which s1 and s2 first differ, or have a zero
+   byte, if it lies within the OK prefixes of both; else the index at
+   which byte-by-byte comparison must resume. */
+static inline __attribute__((always_inline))
+SizeT wordwise_strcmp_from ( const HChar* s1, const HChar* s2, SizeT i )
+{
+   const Addr WM = sizeof(UWord) - 1;
+   if ((((Addr)s1 ^ (Addr)s2) & WM) != 0)
+      return i; /* can't do aligned loads from both */
+   while (True) {
+      Addr  a1 = (Addr)s1 + i;
+      Addr  a2 = (Addr)s2 + i;
+      SizeT n1 = GET_OK_PREFIX(a1, WORDWISE_CHUNK);
+      SizeT n2 = GET_OK_PREFIX(a2, n1);
+      Addr  end1 = a1 + (n1 < n2 ? n1 : n2);
+      if (end1 - a1 < 4 * sizeof(UWord))
+         return i;
+      while ((a1 & WM) != 0) {
+         UChar c1 = *(const UChar*)a1;
+         if (c1 != *(const UChar*)a2 || c1 == 0) return a1 - (Addr)s1;
+         a1++; a2++;
+      }
+      while (a1 + sizeof(UWord) <= end1) {
+         UWord w1 = *(const UWord*)a1;
+         if (w1 != *(const UWord*)a2 || WORD_HAS_ZERO_BYTE(w1))
+            break;
+         a1 += sizeof(UWord); a2 += sizeof(UWord);
+      }
+      while (a1 < end1) {
+         UChar c1 = *(const UChar*)a1;
+         if (c1 != *(const UChar*)a2 || c1 == 0) return a1 - (Addr)s1;
+         a1++; a2++;
+      }
+      i = a1 - (Addr)s1;
+   }
+}
+
+/* Returns the index of the first byte equal to c0 in p[i .. n-1], or n
+   if there is none, if that lies within the OK prefixes; else the index
+   at which byte-by-byte scanning must resume. */
+static inline __attribute__((always_inline))
+SizeT wordwise_memchr_from ( const UChar* p, UChar c0, SizeT i, SizeT n )
+{
+   const Addr WM = sizeof(UWord) - 1;
+   const UWord cw = WORD_ONES * c0;
+   while (i < n) {
+      Addr a   = (Addr)p + i;
+      Addr end = a + GET_OK_PREFIX(a, n - i < WORDWISE_CHUNK
+                                         ? n - i : WORDWISE_CHUNK);
+      if (end - a < 4 * sizeof(UWord))
+         return i;
+      while ((a & WM) != 0) {
+         if (*(const UChar*)a == c0) return a - (Addr)p;
+         a++;
+      }
+      while (a + sizeof(UWord) <= end
+             && !WORD_HAS_ZERO_BYTE(*(const UWord*)a ^ cw))
+         a += sizeof(UWord);
+      while (a < end) {
+         if (*(const UChar*)a == c0) return a - (Addr)p;
+         a++;
+      }
+      i = a - (Addr)p;
+   }
+   return n;
+}
 
 
 /*---------------------- strrchr ----------------------*/
@@ -451,7 +568,13 @@ static inline void my_exit ( int x )
       ( const char* str )  \
    { \
       SizeT i = 0; \
-      while (str[i] != 0) i++; \
+      while (str[i] != 0) { \
+         i++; \
+         if (i == WORDWISE_MIN) { \
+            i = wordwise_strlen_from(str, i); \
+            if (str[i] == 0) break; \
+         } \
+      } \
       return i; \
    }
 
@@ -831,12 +954,17 @@ static inline void my_exit ( int x )
    { \
       register UChar c1; \
       register UChar c2; \
+      SizeT i = 0; \
       while (True) { \
          c1 = *(const UChar *)s1; \
          c2 = *(const UChar *)s2; \
          if (c1 != c2) break; \
          if (c1 == 0) break; \
          s1++; s2++; \
+         if (++i == WORDWISE_MIN) { \
+            SizeT j = wordwise_strcmp_from(s1, s2, 0); \
+            s1 += j; s2 += j; \
+         } \
       } \
       if ((UChar)c1 < (UChar)c2) return -1; \
       if ((UChar)c1 > (UChar)c2) return 1; \
@@ -879,8 +1007,13 @@ static inline void my_exit ( int x )
       SizeT i; \
       UChar c0 = (UChar)c; \
       const UChar* p = s; \
-      for (i = 0; i < n; i++) \
+      for (i = 0; i < n; i++) { \
+         if (i == WORDWISE_MIN) { \
+            i = wordwise_memchr_from(p, c0, i, n); \
+            if (i == n) break; \
+         } \
          if (p[i] == c0) return CONST_CAST(void *,&p[i]); \
+      } \
       return NULL; \
    }
 